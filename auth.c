@@ -5,6 +5,7 @@
  *      Author: oc
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -13,12 +14,36 @@
 #include <unistd.h>
 #include <string.h>
 #include <alloca.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <security/pam_appl.h>
 
-typedef struct UserAuthenticationData_ {
-    char *login;
-    char *password;
-} UserAuthenticationData;
+#include "auth.h"
+
+struct AuthSession_ {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t answered;
+    int notify[2];
+    UserAuthenticationData *userData;
+    AuthBackend backend;
+    AuthBackend fallback;
+    int fallbackOn;
+    AuthStatus status;
+    AuthPromptStyle style;
+    int interactive;
+    char prompt[256];
+    char notice[256];
+    char *answer;
+    int hasAnswer;
+    int result;
+};
+
+typedef struct PamConversation_ {
+    const UserAuthenticationData *userData;
+    int authenticating;     /* in pam_authenticate, not pam_chauthtok */
+    int passwordUsed;
+} PamConversation;
 
 #if 0
 int compare(const char *s1, const char *s2)
@@ -48,7 +73,7 @@ int auth_shadow(const UserAuthenticationData *userData)
     if (entry) {
         const char *pwdhash = crypt(userData->password, entry->sp_pwdp);
         if (pwdhash) {
-            if (strcmp(pwdhash, entry->sp_pwdp) != 0) { //TODO: use a constant time compare function
+            if (!auth_equal(pwdhash, entry->sp_pwdp)) {
                 error = EINVAL;
                 syslog(LOG_ERR,"invalid password for user %s",userData->login);
             }
@@ -64,23 +89,105 @@ int auth_shadow(const UserAuthenticationData *userData)
     return error;
 }
 
+static inline void wake_up_loop(AuthSession *session)
+{
+    const char c = 0;
+    if (write(session->notify[1],&c,sizeof(c)) < 0) {
+        syslog(LOG_ERR,"auth session notification error %d (%m)",errno);
+    }
+}
+
+/* called from the worker thread: shown with the next prompt */
+static void notify_session(AuthSession *session, const char *msg)
+{
+    if (session) {
+        pthread_mutex_lock(&session->lock);
+        strncpy(session->notice,(msg)?msg:"",sizeof(session->notice) - 1);
+        pthread_mutex_unlock(&session->lock);
+    }
+}
+
+/* called from the worker thread: suspend the transaction until the event loop answers */
+static char *ask_session(AuthSession *session, AuthPromptStyle style, const char *msg)
+{
+    char *answer = NULL;
+    if ((session) && (session->interactive)) {
+        pthread_mutex_lock(&session->lock);
+        session->style = style;
+        strncpy(session->prompt,(msg)?msg:"",sizeof(session->prompt) - 1);
+        session->hasAnswer = 0;
+        session->status = AuthPrompt;
+        pthread_mutex_unlock(&session->lock);
+        wake_up_loop(session);
+
+        pthread_mutex_lock(&session->lock);
+        while (!session->hasAnswer) {
+            pthread_cond_wait(&session->answered,&session->lock);
+        }
+        answer = session->answer;
+        session->answer = NULL;
+        session->status = AuthPending;
+        pthread_mutex_unlock(&session->lock);
+    } else {
+        syslog(LOG_ERR,"no way to answer the question \"%s\"",msg);
+    }
+    return answer;
+}
+
+int auth_equal(const char *a, const char *b)
+{
+    const size_t na = strlen(a);
+    const size_t nb = strlen(b);
+    volatile unsigned char diff = (na != nb);
+    for (register size_t i = 0; i < na; i++) {
+        diff |= a[i] ^ b[(i < nb)?i:0];
+    }
+    return (0 == diff);
+}
+
+int auth_deny(const UserAuthenticationData *userData)
+{
+    syslog(LOG_ERR,"user %s is not allowed to unlock",userData->login);
+    return EPERM;
+}
+
 static int pam_conversation(int num_msg, const struct pam_message **msg, struct pam_response **resp, void *appdata_ptr)
 {
     int pam_status = PAM_SUCCESS;
     if ((num_msg >0 ) && (num_msg < PAM_MAX_NUM_MSG)) {
         struct pam_response *aresp = calloc((size_t) num_msg, sizeof *aresp);
         if (aresp) {
-            UserAuthenticationData *userData = (UserAuthenticationData *) appdata_ptr;
+            PamConversation *conversation = (PamConversation *) appdata_ptr;
+            const UserAuthenticationData *userData = conversation->userData;
             for (register int i = 0; (i < num_msg) && (PAM_SUCCESS == pam_status); i++) {
                 switch (msg[i]->msg_style) {
                 case PAM_PROMPT_ECHO_ON:
-                    aresp[i].resp = strdup(userData->login);
+                    /* PAM_USER is set by pam_start: never the login */
+                    aresp[i].resp = ask_session(userData->session,AuthEchoOn,msg[i]->msg);
+                    if (NULL == aresp[i].resp) {
+                        pam_status = PAM_CONV_ERR;
+                    }
                     break;
                 case PAM_PROMPT_ECHO_OFF:
-                    aresp[i].resp = strdup(userData->password);
+                    /* the first hidden prompt of pam_authenticate, whatever its text
+                     * (pam_krb5, pam_ldap, custom authtok_prompt...) */
+                    if ((conversation->authenticating) && (!conversation->passwordUsed)) {
+                        conversation->passwordUsed = 1;
+                        aresp[i].resp = strdup(userData->password);
+                    } else {
+                        aresp[i].resp = ask_session(userData->session,AuthEchoOff,msg[i]->msg);
+                    }
+                    if (NULL == aresp[i].resp) {
+                        pam_status = PAM_CONV_ERR;
+                    }
                     break;
                 case PAM_TEXT_INFO:
+                    syslog(LOG_INFO,"user %s: %s",userData->login,msg[i]->msg);
+                    notify_session(userData->session,msg[i]->msg);
+                    break;
                 case PAM_ERROR_MSG:
+                    syslog(LOG_WARNING,"user %s: %s",userData->login,msg[i]->msg);
+                    notify_session(userData->session,msg[i]->msg);
                     break;
                 default:
                     pam_status = PAM_CONV_ERR;
@@ -112,41 +219,67 @@ static int pam_conversation(int num_msg, const struct pam_message **msg, struct
     return pam_status;
 }
 
+/* pam_acct_mgmt, and pam_chauthtok when the password has expired */
+static int check_account(pam_handle_t *pamh, const UserAuthenticationData *userData, int *pam_status)
+{
+    int error = EXIT_SUCCESS;
+    *pam_status = pam_acct_mgmt(pamh, PAM_SILENT);
+    switch(*pam_status) {
+    case PAM_SUCCESS:
+        break;
+    case PAM_USER_UNKNOWN:
+    case PAM_ACCT_EXPIRED:
+        error = ENOENT;
+        syslog(LOG_ERR, "user %s account check error %s",userData->login,pam_strerror(pamh, *pam_status));
+        break;
+    case PAM_NEW_AUTHTOK_REQD: {
+        /* the new password is asked through the conversation, not retried forever */
+        int attempts = 0;
+        do {
+            *pam_status = pam_chauthtok(pamh, PAM_CHANGE_EXPIRED_AUTHTOK);
+            attempts++;
+        } while((PAM_AUTHTOK_ERR == *pam_status) && (attempts < AUTH_MAX_CHAUTHTOK_ATTEMPTS));
+        if (*pam_status != PAM_SUCCESS) {
+            error = EPERM;
+            syslog(LOG_ERR, "user %s password expired then error %s",userData->login,pam_strerror(pamh, *pam_status));
+        }
+        }
+        break;
+    default:
+        error = EPERM;
+        syslog(LOG_ERR, "user %s account check error %s",userData->login,pam_strerror(pamh, *pam_status));
+        break;
+    }
+    return error;
+}
+
 int auth_pam(const UserAuthenticationData *userData)
 {
     int error = EXIT_SUCCESS;
     pam_handle_t *pamh = NULL;
+    PamConversation conversation = {
+        .userData = userData,
+        .authenticating = 1,
+        .passwordUsed = 0
+    };
     struct pam_conv pamconv = {
         .conv = pam_conversation,
-        .appdata_ptr = userData,
+        .appdata_ptr = &conversation,
     };
 
     int pam_status = pam_start("xtrlock",userData->login,&pamconv,&pamh);
     if (PAM_SUCCESS == pam_status) {
         pam_status = pam_authenticate(pamh, PAM_SILENT);
+        conversation.authenticating = 0;
         if (PAM_SUCCESS == pam_status) {
-            pam_status = pam_acct_mgmt(pamh, PAM_SILENT);
-            switch(pam_status) {
-            case PAM_SUCCESS:
-                break;
-            case PAM_USER_UNKNOWN:
-            case PAM_ACCT_EXPIRED:
-                error = ENOENT;
-                syslog(LOG_ERR, "user %s account check error %s",userData->login,pam_strerror(pamh, pam_status));
-                break;
-            case PAM_NEW_AUTHTOK_REQD:
-                do {
-                    pam_status = pam_chauthtok(pamh, 0);
-                } while(PAM_AUTHTOK_ERR == pam_status);
-                if (pam_status != PAM_SUCCESS) {
-                    error = EPERM;
-                    syslog(LOG_ERR, "user %s password expired then error %s",userData->login,pam_strerror(pamh, pam_status));
-                }
-            }
+            error = check_account(pamh,userData,&pam_status);
         } else {
             syslog(LOG_ERR, "user %s authenticate error %s",userData->login,pam_strerror(pamh, pam_status));
             if (PAM_USER_UNKNOWN == pam_status) {
                 error = ENOENT;
+            } else if (PAM_AUTHINFO_UNAVAIL == pam_status) {
+                /* the authentication service (directory...) cannot be reached */
+                error = EAGAIN;
             } else {
                 error = EINVAL;
             }
@@ -164,5 +297,141 @@ int auth_pam(const UserAuthenticationData *userData)
     return error;
 }
 
+int auth_pam_account(const UserAuthenticationData *userData)
+{
+    int error = EXIT_SUCCESS;
+    pam_handle_t *pamh = NULL;
+    /* no pam_authenticate: the typed password answers no prompt */
+    PamConversation conversation = {
+        .userData = userData,
+        .authenticating = 0,
+        .passwordUsed = 0
+    };
+    struct pam_conv pamconv = {
+        .conv = pam_conversation,
+        .appdata_ptr = &conversation,
+    };
+
+    int pam_status = pam_start("xtrlock",userData->login,&pamconv,&pamh);
+    if (PAM_SUCCESS == pam_status) {
+        error = check_account(pamh,userData,&pam_status);
+        const int pam_end_status = pam_end(pamh, pam_status);
+        if (pam_end_status != PAM_SUCCESS) {
+            syslog(LOG_ERR, pam_strerror(pamh, pam_end_status));
+        }
+    } else {
+        syslog(LOG_ERR,"pam_start error %d",pam_status);
+        error = EAGAIN;
+    }
+    return error;
+}
+
+static void *auth_session_worker(void *data)
+{
+    AuthSession *session = (AuthSession *)data;
+    int result = session->backend(session->userData);
+    if ((result != EXIT_SUCCESS) && (session->fallback)
+            && ((AUTH_ANY_ERROR == session->fallbackOn) || (result == session->fallbackOn))) {
+        result = session->fallback(session->userData);
+    }
+    pthread_mutex_lock(&session->lock);
+    session->result = result;
+    session->status = AuthDone;
+    pthread_mutex_unlock(&session->lock);
+    wake_up_loop(session);
+    return NULL;
+}
 
+int auth_session_start(UserAuthenticationData *userData, AuthBackend backend,
+                       AuthBackend fallback, int fallbackOn, int interactive, AuthSession **session)
+{
+    int error = EXIT_SUCCESS;
+    AuthSession *s = calloc(1,sizeof(AuthSession));
+    if (s) {
+        if (pipe2(s->notify,O_CLOEXEC|O_NONBLOCK) == 0) {
+            pthread_mutex_init(&s->lock,NULL);
+            pthread_cond_init(&s->answered,NULL);
+            s->userData = userData;
+            s->backend = backend;
+            s->fallback = fallback;
+            s->fallbackOn = fallbackOn;
+            s->interactive = interactive;
+            s->status = AuthPending;
+            userData->session = s;
+            error = pthread_create(&s->thread,NULL,auth_session_worker,s);
+            if (error != 0) {
+                syslog(LOG_ERR,"pthread_create error %d",error);
+                userData->session = NULL;
+                pthread_cond_destroy(&s->answered);
+                pthread_mutex_destroy(&s->lock);
+                close(s->notify[0]);
+                close(s->notify[1]);
+            }
+        } else {
+            error = errno;
+            syslog(LOG_ERR,"pipe error %d (%m)",error);
+        }
+        if (error != EXIT_SUCCESS) {
+            free(s);
+            s = NULL;
+        }
+    } else {
+        error = ENOMEM;
+    }
+    *session = s;
+    return error;
+}
+
+int auth_session_fd(const AuthSession *session)
+{
+    return session->notify[0];
+}
+
+AuthStatus auth_session_poll(AuthSession *session, AuthPromptStyle *style, const char **prompt,
+                             const char **notice)
+{
+    char buffer[16];
+    while (read(session->notify[0],buffer,sizeof(buffer)) > 0);
 
+    pthread_mutex_lock(&session->lock);
+    const AuthStatus status = session->status;
+    if (AuthPrompt == status) {
+        *style = session->style;
+        *prompt = session->prompt;
+    }
+    *notice = session->notice;
+    pthread_mutex_unlock(&session->lock);
+    return status;
+}
+
+int auth_session_answer(AuthSession *session, const char *answer)
+{
+    int error = EXIT_SUCCESS;
+    pthread_mutex_lock(&session->lock);
+    if ((AuthPrompt == session->status) && (!session->hasAnswer)) {
+        session->answer = (answer)?strdup(answer):NULL;
+        if ((answer) && (NULL == session->answer)) {
+            error = ENOMEM;
+        }
+        session->hasAnswer = 1;
+        session->notice[0] = '\0';
+        pthread_cond_signal(&session->answered);
+    } else {
+        error = EINVAL;
+    }
+    pthread_mutex_unlock(&session->lock);
+    return error;
+}
+
+int auth_session_end(AuthSession *session)
+{
+    pthread_join(session->thread,NULL);
+    const int result = session->result;
+    session->userData->session = NULL;
+    pthread_cond_destroy(&session->answered);
+    pthread_mutex_destroy(&session->lock);
+    close(session->notify[0]);
+    close(session->notify[1]);
+    free(session);
+    return result;
+}
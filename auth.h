@@ -13,13 +13,31 @@
 #ifndef AUTH_H_
 #define AUTH_H_
 
+/* Size of the answers typed for the questions asked by the backend */
+#define AUTH_MAX_ANSWER 512
+
+/* Bounded number of new password prompts when the account has expired */
+#define AUTH_MAX_CHAUTHTOK_ATTEMPTS 3
+
+typedef struct AuthSession_ AuthSession;
+
 typedef struct UserAuthenticationData_ {
     char *login;
     char *password;
+    AuthSession *session; /* NULL: questions after the password prompt fail */
 } UserAuthenticationData;
 
+typedef int (*AuthBackend)(const UserAuthenticationData *userData);
+
 int auth_shadow(const UserAuthenticationData *userData);
 int auth_pam(const UserAuthenticationData *userData);
+/* the account checks of auth_pam (pam_acct_mgmt) without pam_authenticate */
+int auth_pam_account(const UserAuthenticationData *userData);
+/* refuse the users who are not allowed to unlock */
+int auth_deny(const UserAuthenticationData *userData);
+
+/* constant time comparison of two password hashes */
+int auth_equal(const char *a, const char *b);
 
 #ifdef AUTH_USE_PAM
 #define authenticate auth_pam
@@ -27,4 +45,36 @@ int auth_pam(const UserAuthenticationData *userData);
 #define authenticate auth_shadow
 #endif
 
+/*
+ * Asynchronous authentication: the backend runs in a worker thread. Only the
+ * first hidden prompt of pam_authenticate is answered with the typed password;
+ * in an interactive session the other questions are handed back to the event
+ * loop with the last PAM message, the transaction resumes when they are
+ * answered. They fail in a non interactive session.
+ */
+typedef enum AuthStatus_ {
+    AuthPending,
+    AuthPrompt,
+    AuthDone
+} AuthStatus;
+
+typedef enum AuthPromptStyle_ {
+    AuthEchoOn,
+    AuthEchoOff
+} AuthPromptStyle;
+
+/* fallback (may be NULL) runs when backend fails with fallbackOn, or any error if AUTH_ANY_ERROR */
+#define AUTH_ANY_ERROR (-1)
+int auth_session_start(UserAuthenticationData *userData, AuthBackend backend,
+                       AuthBackend fallback, int fallbackOn, int interactive, AuthSession **session);
+/* readable when auth_session_poll() status has changed */
+int auth_session_fd(const AuthSession *session);
+/* notice: last information or error message of the backend, "" if none */
+AuthStatus auth_session_poll(AuthSession *session, AuthPromptStyle *style, const char **prompt,
+                             const char **notice);
+/* answer == NULL cancels the question */
+int auth_session_answer(AuthSession *session, const char *answer);
+/* wait for the end of the worker and return its authentication result */
+int auth_session_end(AuthSession *session);
+
 #endif /* AUTH_H_ */
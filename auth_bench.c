@@ -0,0 +1,408 @@
+/*
+ * auth_bench.c
+ *
+ * Latency and allocations of the authentication backends, measured in a
+ * private mount namespace (and user namespace when not run as root) where
+ * temporary passwd, shadow, nsswitch.conf and pam.d replace the ones of
+ * /etc: no real account, no network, nothing changed on the machine.
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <crypt.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+
+#include "auth.h"
+#include "credcache.h"
+
+#define ITERATIONS      100
+#define PAM_DELAY_MS    10
+#define PASSWORD        "correct horse"
+#define WRONG_PASSWORD  "battery staple"
+#define UNKNOWN_LOGIN   "bench-nobody"
+
+/* allocations of the process, libpam and its modules included */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static unsigned long allocations = 0;
+static unsigned long allocatedBytes = 0;
+
+static inline void count_allocation(size_t size)
+{
+    __atomic_add_fetch(&allocations,1,__ATOMIC_RELAXED);
+    __atomic_add_fetch(&allocatedBytes,size,__ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    count_allocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    count_allocation(count * size);
+    return __libc_calloc(count,size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    count_allocation(size);
+    return __libc_realloc(p,size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size)
+{
+    count_allocation(size);
+    *p = __libc_memalign(alignment,size);
+    return (*p)?0:ENOMEM;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    count_allocation(size);
+    return __libc_memalign(alignment,size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    count_allocation(size);
+    return __libc_memalign(alignment,size);
+}
+
+typedef struct Scheme_ {
+    const char *name;
+    const char *prefix;
+    char hash[CRYPT_OUTPUT_SIZE];
+} Scheme;
+
+static Scheme schemes[] = {
+    { "des", "", "" },
+    { "md5", "$1$", "" },
+    { "sha512", "$6$", "" },
+    { "yescrypt", "$y$", "" }
+};
+#define SCHEMES_COUNT (sizeof(schemes)/sizeof(schemes[0]))
+#define DEFAULT_SCHEME  2   /* sha512 */
+
+typedef enum PamStack_ {
+    NoPam,
+    PamUnix,
+    PamPermit,
+    PamExecDelay
+} PamStack;
+
+typedef struct Backend_ {
+    const char *name;
+    AuthBackend backend;
+    PamStack stack;
+    int perScheme;      /* else run with the sha512 account only */
+} Backend;
+
+static const Backend backends[] = {
+    { "shadow", auth_shadow, NoPam, 1 },
+    { "credcache", auth_credcache, NoPam, 1 },
+    { "pam_unix", auth_pam, PamUnix, 1 },
+    { "pam_permit", auth_pam, PamPermit, 0 },
+    { "pam_exec+unix", auth_pam, PamExecDelay, 0 }
+};
+
+typedef enum Case_ {
+    Success,
+    WrongPassword,
+    UnknownUser
+} Case;
+
+static const char *const caseNames[] = { "success", "wrong password", "unknown user" };
+
+static char directory[] = "/tmp/xtrlock-bench.XXXXXX";
+static const char *const overlays[] = { "passwd", "shadow", "nsswitch.conf", "pam.d" };
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int write_file(const char *name, mode_t mode, const char *content)
+{
+    char path[256];
+    snprintf(path,sizeof(path),"%s/%s",directory,name);
+    FILE *f = fopen(path,"we");
+    if ((NULL == f) || (fputs(content,f) == EOF) || (fclose(f) != 0) || (chmod(path,mode) != 0)) {
+        fprintf(stderr,"cannot write %s: %s\n",path,strerror(errno));
+        return errno;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int write_id_map(const char *file, const char *map)
+{
+    const int fd = open(file,O_WRONLY|O_CLOEXEC);
+    const ssize_t length = strlen(map);
+    int error = EXIT_SUCCESS;
+    if ((-1 == fd) || (write(fd,map,length) != length)) {
+        error = errno;
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    return error;
+}
+
+/* private mounts, and root of a user namespace when not really root */
+static int enter_namespaces(void)
+{
+    int error = EXIT_SUCCESS;
+    const uid_t uid = geteuid();
+    const gid_t gid = getegid();
+    if (0 == uid) {
+        if (unshare(CLONE_NEWNS) != 0) {
+            error = errno;
+        }
+    } else if (unshare(CLONE_NEWUSER|CLONE_NEWNS) != 0) {
+        error = errno;
+    } else {
+        char map[32];
+        snprintf(map,sizeof(map),"0 %u 1",uid);
+        error = write_id_map("/proc/self/uid_map",map);
+        if (EXIT_SUCCESS == error) {
+            write_id_map("/proc/self/setgroups","deny");
+            snprintf(map,sizeof(map),"0 %u 1",gid);
+            error = write_id_map("/proc/self/gid_map",map);
+        }
+    }
+    if ((EXIT_SUCCESS == error) && (mount(NULL,"/",NULL,MS_REC|MS_PRIVATE,NULL) != 0)) {
+        error = errno;
+    }
+    if (error != EXIT_SUCCESS) {
+        fprintf(stderr,"cannot enter private namespaces: %s\n",strerror(error));
+    }
+    return error;
+}
+
+static int write_pam_service(PamStack stack)
+{
+    char content[512];
+    switch (stack) {
+    case PamUnix:
+        /* nodelay: the 2 s delay of pam_unix after a failure is not the backend cost */
+        snprintf(content,sizeof(content),"auth required pam_unix.so nodelay\naccount required pam_unix.so\n");
+        break;
+    case PamPermit:
+        snprintf(content,sizeof(content),"auth required pam_permit.so\naccount required pam_permit.so\n");
+        break;
+    case PamExecDelay:
+        snprintf(content,sizeof(content),
+                 "auth requisite pam_exec.so quiet %s/delay\nauth required pam_unix.so nodelay\n"
+                 "account required pam_unix.so\n",directory);
+        break;
+    default:
+        return EXIT_SUCCESS;
+    }
+    return write_file("pam.d/xtrlock",0644,content);
+}
+
+static int write_credcache(const char *path)
+{
+    CredCacheHeader header;
+    CredCacheEntry entries[SCHEMES_COUNT];
+    memset(&header,0,sizeof(header));
+    memset(entries,0,sizeof(entries));
+    memcpy(header.magic,CREDCACHE_MAGIC,sizeof(header.magic));
+    header.version = CREDCACHE_VERSION;
+    header.count = SCHEMES_COUNT;
+    header.generated = time(NULL);
+    /* "bench-<scheme>" sort as the schemes table does */
+    for (size_t s = 0; s < SCHEMES_COUNT; s++) {
+        snprintf(entries[s].login,sizeof(entries[s].login),"bench-%s",schemes[s].name);
+        strncpy(entries[s].hash,schemes[s].hash,sizeof(entries[s].hash) - 1);
+    }
+    FILE *f = fopen(path,"we");
+    if ((NULL == f) || (fwrite(&header,sizeof(header),1,f) != 1)
+            || (fwrite(entries,sizeof(entries),1,f) != 1) || (fclose(f) != 0)) {
+        fprintf(stderr,"cannot write %s: %s\n",path,strerror(errno));
+        return errno;
+    }
+    return chmod(path,0600);
+}
+
+static int setup(void)
+{
+    int error = enter_namespaces();
+    if ((EXIT_SUCCESS == error) && (NULL == mkdtemp(directory))) {
+        error = errno;
+        fprintf(stderr,"mkdtemp: %s\n",strerror(error));
+    }
+    if (error != EXIT_SUCCESS) {
+        return error;
+    }
+
+    char passwd[1024] = "root:x:0:0:root:/root:/bin/sh\n";
+    char shadow[2048] = "root:*:19000:0:99999:7:::\n";
+    for (size_t s = 0; s < SCHEMES_COUNT; s++) {
+        char salt[CRYPT_GENSALT_OUTPUT_SIZE];
+        struct crypt_data data;
+        memset(&data,0,sizeof(data));
+        const char *hash = NULL;
+        if ((NULL == crypt_gensalt_rn(schemes[s].prefix,0,NULL,0,salt,sizeof(salt)))
+                || (NULL == (hash = crypt_r(PASSWORD,salt,&data))) || ('*' == *hash)) {
+            fprintf(stderr,"%s hashes are not supported by libcrypt\n",schemes[s].name);
+            continue;
+        }
+        snprintf(schemes[s].hash,sizeof(schemes[s].hash),"%s",hash);
+        const size_t p = strlen(passwd), h = strlen(shadow);
+        snprintf(passwd + p,sizeof(passwd) - p,"bench-%s:x:%zu:%zu::/nonexistent:/bin/sh\n",
+                 schemes[s].name,60000 + s,60000 + s);
+        snprintf(shadow + h,sizeof(shadow) - h,"bench-%s:%s:19000:0:99999:7:::\n",
+                 schemes[s].name,schemes[s].hash);
+    }
+
+    char path[256];
+    snprintf(path,sizeof(path),"%s/pam.d",directory);
+    if (mkdir(path,0755) != 0) {
+        return errno;
+    }
+    char delay[128];
+    snprintf(delay,sizeof(delay),"#!/bin/sh\nexec sleep %d.%03d\n",PAM_DELAY_MS / 1000,PAM_DELAY_MS % 1000);
+    if (((error = write_file("passwd",0644,passwd)) != EXIT_SUCCESS)
+            || ((error = write_file("shadow",0600,shadow)) != EXIT_SUCCESS)
+            || ((error = write_file("nsswitch.conf",0644,"passwd: files\ngroup: files\nshadow: files\n")) != EXIT_SUCCESS)
+            || ((error = write_file("delay",0755,delay)) != EXIT_SUCCESS)
+            || ((error = write_file("pam.d/other",0644,"auth required pam_deny.so\naccount required pam_deny.so\n")) != EXIT_SUCCESS)) {
+        return error;
+    }
+    snprintf(path,sizeof(path),"%s/credentials",directory);
+    if ((error = write_credcache(path)) != EXIT_SUCCESS) {
+        return error;
+    }
+    credcache_set_path(path);
+
+    for (size_t o = 0; o < sizeof(overlays)/sizeof(overlays[0]); o++) {
+        char source[256], target[256];
+        snprintf(source,sizeof(source),"%s/%s",directory,overlays[o]);
+        snprintf(target,sizeof(target),"/etc/%s",overlays[o]);
+        if (mount(source,target,NULL,MS_BIND,NULL) != 0) {
+            error = errno;
+            fprintf(stderr,"cannot bind %s on %s: %s\n",source,target,strerror(error));
+            return error;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static void cleanup(void)
+{
+    char path[256];
+    for (size_t o = 0; o < sizeof(overlays)/sizeof(overlays[0]); o++) {
+        snprintf(path,sizeof(path),"/etc/%s",overlays[o]);
+        umount2(path,MNT_DETACH);
+    }
+    credcache_set_path(NULL);
+    const char *const files[] = { "pam.d/xtrlock", "pam.d/other", "passwd", "shadow", "nsswitch.conf",
+                                  "delay", "credentials" };
+    for (size_t f = 0; f < sizeof(files)/sizeof(files[0]); f++) {
+        snprintf(path,sizeof(path),"%s/%s",directory,files[f]);
+        unlink(path);
+    }
+    snprintf(path,sizeof(path),"%s/pam.d",directory);
+    rmdir(path);
+    rmdir(directory);
+}
+
+static void run(const Backend *backend, const Scheme *scheme, Case c, int iterations)
+{
+    char login[64];
+    double *times = malloc(iterations * sizeof(double));
+    unsigned long totalAllocations = 0, totalBytes = 0;
+    int result = 0, consistent = 1;
+
+    snprintf(login,sizeof(login),"bench-%s",scheme->name);
+    UserAuthenticationData userData = {
+        .login = (UnknownUser == c)?UNKNOWN_LOGIN:login,
+        .password = (WrongPassword == c)?WRONG_PASSWORD:PASSWORD,
+        .session = NULL
+    };
+    /* warm up: modules loaded, files in the page cache */
+    result = backend->backend(&userData);
+    for (int i = 0; i < iterations; i++) {
+        const unsigned long a = allocations, b = allocatedBytes;
+        const double start = now_ms();
+        const int r = backend->backend(&userData);
+        times[i] = now_ms() - start;
+        totalAllocations += allocations - a;
+        totalBytes += allocatedBytes - b;
+        consistent &= (r == result);
+    }
+    qsort(times,iterations,sizeof(double),compare_doubles);
+    printf("%-14s %-9s %-15s %8.3f %8.3f %8.3f %8.3f %8.3f %7.1f %9.0f  %d%s\n",
+           backend->name,scheme->name,caseNames[c],
+           times[0],times[iterations / 2],times[iterations * 9 / 10],times[iterations * 99 / 100],
+           times[iterations - 1],(double)totalAllocations / iterations,(double)totalBytes / iterations,
+           result,(consistent)?"":" (varies)");
+    free(times);
+}
+
+int main(int argc, char *argv[])
+{
+    const int iterations = (argc > 1)?atoi(argv[1]):ITERATIONS;
+    if (iterations <= 0) {
+        fprintf(stderr,"usage: %s [iterations]\n",argv[0]);
+        return EXIT_FAILURE;
+    }
+    /* the failures logged by the backends are not sent */
+    openlog("auth_bench",0,LOG_AUTH);
+    setlogmask(LOG_UPTO(LOG_EMERG));
+
+    const int error = setup();
+    if (error != EXIT_SUCCESS) {
+        cleanup();
+        return EXIT_FAILURE;
+    }
+    printf("%d iterations, pam_exec delay %d ms, latencies in ms, allocations and bytes per attempt\n",
+           iterations,PAM_DELAY_MS);
+    printf("%-14s %-9s %-15s %8s %8s %8s %8s %8s %7s %9s  %s\n",
+           "backend","hash","case","min","p50","p90","p99","max","allocs","bytes","result");
+    for (size_t b = 0; b < sizeof(backends)/sizeof(backends[0]); b++) {
+        const Backend *backend = &backends[b];
+        if (write_pam_service(backend->stack) != EXIT_SUCCESS) {
+            break;
+        }
+        for (size_t s = 0; s < SCHEMES_COUNT; s++) {
+            const Scheme *scheme = &schemes[(backend->perScheme)?s:DEFAULT_SCHEME];
+            if ('\0' == scheme->hash[0]) {
+                continue;
+            }
+            for (Case c = Success; c <= UnknownUser; c++) {
+                run(backend,scheme,c,iterations);
+            }
+            if (!backend->perScheme) {
+                break;
+            }
+        }
+    }
+    cleanup();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+/*
+ * blur.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "blur.h"
+
+typedef uint32_t (*BlockAverage)(const uint8_t *origin, size_t stride, unsigned int bw, unsigned int bh);
+typedef void (*BlockFill)(uint8_t *origin, size_t stride, unsigned int bw, unsigned int bh, uint32_t colour);
+
+static inline uint32_t average_of(const uint32_t sums[4], unsigned int n)
+{
+    uint32_t colour = 0;
+    for (register int c = 3; c >= 0; c--) {
+        colour = (colour << 8) | ((sums[c] + n / 2) / n);
+    }
+    return colour;
+}
+
+static uint32_t average_scalar(const uint8_t *origin, size_t stride, unsigned int bw, unsigned int bh)
+{
+    uint32_t sums[4] = { 0, 0, 0, 0 };
+    for (register unsigned int y = 0; y < bh; y++) {
+        const uint8_t *p = origin + y * stride;
+        for (register unsigned int x = 0; x < bw; x++, p += 4) {
+            sums[0] += p[0];
+            sums[1] += p[1];
+            sums[2] += p[2];
+            sums[3] += p[3];
+        }
+    }
+    return average_of(sums,bw * bh);
+}
+
+static void fill_scalar(uint8_t *origin, size_t stride, unsigned int bw, unsigned int bh, uint32_t colour)
+{
+    for (register unsigned int y = 0; y < bh; y++) {
+        uint32_t *p = (uint32_t *)(origin + y * stride);
+        for (register unsigned int x = 0; x < bw; x++) {
+            p[x] = colour;
+        }
+    }
+}
+
+/* full blocks whose width is a multiple of simdWidth go to the vectorized functions */
+static void pixelate(uint8_t *pixels, unsigned int width, unsigned int height, size_t stride,
+                     unsigned int block, unsigned int simdWidth, BlockAverage average, BlockFill fill)
+{
+    const int simd = (block <= BLUR_MAX_SIMD_BLOCK);
+    for (unsigned int y0 = 0; y0 < height; y0 += block) {
+        const unsigned int bh = (height - y0 < block)?height - y0:block;
+        uint8_t *band = pixels + y0 * stride;
+        for (unsigned int x0 = 0; x0 < width; x0 += block) {
+            const unsigned int bw = (width - x0 < block)?width - x0:block;
+            uint8_t *origin = band + x0 * 4;
+            if ((simd) && (0 == bw % simdWidth)) {
+                fill(origin,stride,bw,bh,average(origin,stride,bw,bh));
+            } else {
+                fill_scalar(origin,stride,bw,bh,average_scalar(origin,stride,bw,bh));
+            }
+        }
+    }
+}
+
+void blur_pixelate_scalar(uint8_t *pixels, unsigned int width, unsigned int height,
+                          size_t stride, unsigned int block)
+{
+    pixelate(pixels,width,height,stride,block,1,average_scalar,fill_scalar);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* 16 bits lanes: up to 16x16 / 2 pixels of 255 per lane, no overflow */
+__attribute__((target("sse2")))
+static uint32_t average_sse2(const uint8_t *origin, size_t stride, unsigned int bw, unsigned int bh)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    uint16_t lanes[8];
+    for (register unsigned int y = 0; y < bh; y++) {
+        const uint8_t *p = origin + y * stride;
+        for (register unsigned int x = 0; x < bw; x += 4, p += 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i *)p);
+            acc = _mm_add_epi16(acc,_mm_unpacklo_epi8(v,zero));
+            acc = _mm_add_epi16(acc,_mm_unpackhi_epi8(v,zero));
+        }
+    }
+    _mm_storeu_si128((__m128i *)lanes,acc);
+    const uint32_t sums[4] = {
+        (uint32_t)lanes[0] + lanes[4], (uint32_t)lanes[1] + lanes[5],
+        (uint32_t)lanes[2] + lanes[6], (uint32_t)lanes[3] + lanes[7]
+    };
+    return average_of(sums,bw * bh);
+}
+
+__attribute__((target("sse2")))
+static void fill_sse2(uint8_t *origin, size_t stride, unsigned int bw, unsigned int bh, uint32_t colour)
+{
+    const __m128i v = _mm_set1_epi32(colour);
+    for (register unsigned int y = 0; y < bh; y++) {
+        uint8_t *p = origin + y * stride;
+        for (register unsigned int x = 0; x < bw; x += 4, p += 16) {
+            _mm_storeu_si128((__m128i *)p,v);
+        }
+    }
+}
+
+void blur_pixelate_sse2(uint8_t *pixels, unsigned int width, unsigned int height,
+                        size_t stride, unsigned int block)
+{
+    pixelate(pixels,width,height,stride,block,4,average_sse2,fill_sse2);
+}
+
+__attribute__((target("avx2")))
+static uint32_t average_avx2(const uint8_t *origin, size_t stride, unsigned int bw, unsigned int bh)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    uint16_t lanes[16];
+    for (register unsigned int y = 0; y < bh; y++) {
+        const uint8_t *p = origin + y * stride;
+        for (register unsigned int x = 0; x < bw; x += 8, p += 32) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            acc = _mm256_add_epi16(acc,_mm256_unpacklo_epi8(v,zero));
+            acc = _mm256_add_epi16(acc,_mm256_unpackhi_epi8(v,zero));
+        }
+    }
+    _mm256_storeu_si256((__m256i *)lanes,acc);
+    uint32_t sums[4];
+    for (register int c = 0; c < 4; c++) {
+        sums[c] = (uint32_t)lanes[c] + lanes[c + 4] + lanes[c + 8] + lanes[c + 12];
+    }
+    return average_of(sums,bw * bh);
+}
+
+__attribute__((target("avx2")))
+static void fill_avx2(uint8_t *origin, size_t stride, unsigned int bw, unsigned int bh, uint32_t colour)
+{
+    const __m256i v = _mm256_set1_epi32(colour);
+    for (register unsigned int y = 0; y < bh; y++) {
+        uint8_t *p = origin + y * stride;
+        for (register unsigned int x = 0; x < bw; x += 8, p += 32) {
+            _mm256_storeu_si256((__m256i *)p,v);
+        }
+    }
+}
+
+void blur_pixelate_avx2(uint8_t *pixels, unsigned int width, unsigned int height,
+                        size_t stride, unsigned int block)
+{
+    pixelate(pixels,width,height,stride,block,8,average_avx2,fill_avx2);
+}
+
+#endif /* __x86_64__ || __i386__ */
+
+PixelateKernel blur_kernel(const char **name)
+{
+    PixelateKernel kernel = blur_pixelate_scalar;
+    const char *kernelName = "scalar";
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = blur_pixelate_avx2;
+        kernelName = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        kernel = blur_pixelate_sse2;
+        kernelName = "sse2";
+    }
+#endif
+    if (name) {
+        *name = kernelName;
+    }
+    return kernel;
+}
+
+void blur_pixelate(uint8_t *pixels, unsigned int width, unsigned int height,
+                   size_t stride, unsigned int block)
+{
+    static PixelateKernel kernel = NULL;
+    if (NULL == kernel) {
+        kernel = blur_kernel(NULL);
+    }
+    kernel(pixels,width,height,stride,block);
+}
@@ -0,0 +1,43 @@
+/*
+ * blur.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef BLUR_H_
+#define BLUR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Size of the pixelation blocks, the vectorized kernels handle up to 16 */
+#define BLUR_BLOCK      16
+#define BLUR_MAX_SIMD_BLOCK 16
+
+/*
+ * Replace each block x block square of a 32 bits per pixel frame by its
+ * average colour, in place. stride is the size of a line in bytes.
+ */
+typedef void (*PixelateKernel)(uint8_t *pixels, unsigned int width, unsigned int height,
+                               size_t stride, unsigned int block);
+
+void blur_pixelate_scalar(uint8_t *pixels, unsigned int width, unsigned int height,
+                          size_t stride, unsigned int block);
+#if defined(__x86_64__) || defined(__i386__)
+void blur_pixelate_sse2(uint8_t *pixels, unsigned int width, unsigned int height,
+                        size_t stride, unsigned int block);
+void blur_pixelate_avx2(uint8_t *pixels, unsigned int width, unsigned int height,
+                        size_t stride, unsigned int block);
+#endif
+
+/* best kernel for this CPU */
+PixelateKernel blur_kernel(const char **name);
+void blur_pixelate(uint8_t *pixels, unsigned int width, unsigned int height,
+                   size_t stride, unsigned int block);
+
+#endif /* BLUR_H_ */
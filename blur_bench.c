@@ -0,0 +1,117 @@
+/*
+ * blur_bench.c
+ *
+ * Time the pixelation kernels of the privacy mode on 4K and multi-head
+ * frames and check that the vectorized kernels match the scalar one.
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "blur.h"
+
+#define ITERATIONS 20
+
+typedef struct Frame_ {
+    const char *name;
+    unsigned int width;
+    unsigned int height;
+} Frame;
+
+static const Frame frames[] = {
+    { "1080p", 1920, 1080 },
+    { "4K", 3840, 2160 },
+    { "2 x 4K", 7680, 2160 },
+    { "3 x 1080p", 5760, 1080 },
+    { "odd 2561x1441", 2561, 1441 }
+};
+
+typedef struct Kernel_ {
+    const char *name;
+    PixelateKernel kernel;
+    int supported;
+} Kernel;
+
+static inline double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void fill_pattern(uint8_t *pixels, size_t size)
+{
+    uint32_t seed = 0x12345678;
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        pixels[i] = seed >> 24;
+    }
+}
+
+int main(void)
+{
+    int error = EXIT_SUCCESS;
+    Kernel kernels[] = {
+        { "scalar", blur_pixelate_scalar, 1 },
+#if defined(__x86_64__) || defined(__i386__)
+        { "sse2", blur_pixelate_sse2, __builtin_cpu_supports("sse2") },
+        { "avx2", blur_pixelate_avx2, __builtin_cpu_supports("avx2") },
+#endif
+    };
+    const char *selected = NULL;
+    blur_kernel(&selected);
+    printf("block %u, %d iterations, selected kernel: %s\n",BLUR_BLOCK,ITERATIONS,selected);
+
+    for (size_t f = 0; f < sizeof(frames)/sizeof(frames[0]); f++) {
+        const Frame *frame = &frames[f];
+        const size_t stride = frame->width * 4;
+        const size_t size = stride * frame->height;
+        uint8_t *source = malloc(size);
+        uint8_t *reference = malloc(size);
+        uint8_t *work = malloc(size);
+        if ((NULL == source) || (NULL == reference) || (NULL == work)) {
+            fprintf(stderr,"out of memory\n");
+            return EXIT_FAILURE;
+        }
+        fill_pattern(source,size);
+        memcpy(reference,source,size);
+        blur_pixelate_scalar(reference,frame->width,frame->height,stride,BLUR_BLOCK);
+
+        for (size_t k = 0; k < sizeof(kernels)/sizeof(kernels[0]); k++) {
+            double times[ITERATIONS];
+            if (!kernels[k].supported) {
+                printf("%-14s %-7s not supported by this CPU\n",frame->name,kernels[k].name);
+                continue;
+            }
+            for (int i = 0; i < ITERATIONS; i++) {
+                memcpy(work,source,size);
+                const double start = now_ms();
+                kernels[k].kernel(work,frame->width,frame->height,stride,BLUR_BLOCK);
+                times[i] = now_ms() - start;
+            }
+            qsort(times,ITERATIONS,sizeof(double),compare_doubles);
+            const int match = (memcmp(work,reference,size) == 0);
+            printf("%-14s %-7s min %7.3f ms  median %7.3f ms  max %7.3f ms  %s\n",
+                   frame->name,kernels[k].name,times[0],times[ITERATIONS / 2],times[ITERATIONS - 1],
+                   (match)?"ok":"MISMATCH");
+            if (!match) {
+                error = EXIT_FAILURE;
+            }
+        }
+        free(source);
+        free(reference);
+        free(work);
+    }
+    return error;
+}
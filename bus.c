@@ -0,0 +1,241 @@
+/*
+ * bus.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#define _GNU_SOURCE /* accept4, struct ucred */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "bus.h"
+#include "loop.h"
+
+#define X(e)    #e,
+static const char *const eventNames[] = {
+    BUS_EVENT_TABLE
+};
+#undef X
+
+static int listenFd = -1;
+static struct sockaddr_un address;
+static int subscribers[BUS_MAX_SUBSCRIBERS];
+static unsigned int nbSubscribers = 0;
+static char owner[64];
+/* replayed to the new subscribers */
+static char lockMessage[BUS_MAX_MESSAGE];
+static size_t lockMessageLength = 0;
+
+static void drop_subscriber(unsigned int index, const char *reason)
+{
+    syslog(LOG_WARNING,"event subscriber %d dropped: %s",subscribers[index],reason);
+    loop_remove(subscribers[index]);
+    close(subscribers[index]);
+    subscribers[index] = subscribers[--nbSubscribers];
+}
+
+static int send_to(unsigned int index, const char *message, size_t length)
+{
+    if (send(subscribers[index],message,length,MSG_DONTWAIT|MSG_NOSIGNAL) == -1) {
+        const int error = errno;
+        drop_subscriber(index,(EAGAIN == error)?"too slow":strerror(error));
+        return error;
+    }
+    return EXIT_SUCCESS;
+}
+
+static void on_subscriber(int fd, short revents, void *data)
+{
+    char discard[64];
+    /* subscribers only listen: anything else is a hang up or an error */
+    const ssize_t length = recv(fd,discard,sizeof(discard),MSG_DONTWAIT);
+    if ((length > 0) || ((-1 == length) && (EAGAIN == errno))) {
+        return;
+    }
+    for (unsigned int i = 0; i < nbSubscribers; i++) {
+        if (subscribers[i] == fd) {
+            loop_remove(fd);
+            close(fd);
+            subscribers[i] = subscribers[--nbSubscribers];
+            break;
+        }
+    }
+}
+
+static void on_connection(int fd, short revents, void *data)
+{
+    struct ucred peer;
+    socklen_t size = sizeof(peer);
+    memset(&peer,0xff,sizeof(peer));
+    const int subscriber = accept4(fd,NULL,NULL,SOCK_NONBLOCK|SOCK_CLOEXEC);
+    if (-1 == subscriber) {
+        return;
+    }
+    if ((getsockopt(subscriber,SOL_SOCKET,SO_PEERCRED,&peer,&size) != 0)
+            || ((peer.uid != getuid()) && (peer.uid != 0))) {
+        syslog(LOG_WARNING,"event subscriber refused (uid %d)",(int)peer.uid);
+        close(subscriber);
+    } else if ((nbSubscribers >= BUS_MAX_SUBSCRIBERS)
+               || (loop_add(subscriber,POLLIN,on_subscriber,NULL,"bus") != EXIT_SUCCESS)) {
+        syslog(LOG_WARNING,"event subscriber refused, %u subscribers",nbSubscribers);
+        close(subscriber);
+    } else {
+        syslog(LOG_DEBUG,"event subscriber %d connected (pid %d)",subscriber,(int)peer.pid);
+        subscribers[nbSubscribers++] = subscriber;
+        if (lockMessageLength) {
+            send_to(nbSubscribers - 1,lockMessage,lockMessageLength);
+        }
+    }
+}
+
+/* $XDG_RUNTIME_DIR/xtrlock, created if needed, must be a private directory of the user */
+static int private_directory(char *path, size_t size)
+{
+    int error = EXIT_SUCCESS;
+    struct stat st;
+    const char *runtime = getenv("XDG_RUNTIME_DIR");
+    if ((NULL == runtime) || (*runtime != '/')) {
+        syslog(LOG_ERR,"XDG_RUNTIME_DIR is not set, no event socket");
+        return ENOENT;
+    }
+    if (snprintf(path,size,"%s/" BUS_DIRECTORY,runtime) >= (int)size) {
+        return ENAMETOOLONG;
+    }
+    if ((mkdir(path,0700) != 0) && (errno != EEXIST)) {
+        error = errno;
+        syslog(LOG_ERR,"cannot create %s error %d (%m)",path,error);
+    } else if (lstat(path,&st) != 0) {
+        error = errno;
+        syslog(LOG_ERR,"%s error %d (%m)",path,error);
+    } else if ((!S_ISDIR(st.st_mode)) || (st.st_uid != getuid()) || (st.st_mode & (S_IRWXG|S_IRWXO))) {
+        error = EPERM;
+        syslog(LOG_ERR,"%s is not a private directory of uid %d",path,(int)getuid());
+    }
+    return error;
+}
+
+/* a socket file nobody listens on is left by a dead locker */
+static Bool stale_socket(void)
+{
+    Bool stale = False;
+    const int fd = socket(AF_UNIX,SOCK_SEQPACKET|SOCK_CLOEXEC,0);
+    if (fd != -1) {
+        stale = ((connect(fd,(struct sockaddr *)&address,sizeof(address)) != 0) && (ECONNREFUSED == errno));
+        close(fd);
+    }
+    return stale;
+}
+
+int bus_open(const char *displayName, const char *sessionOwner)
+{
+    int error = EXIT_SUCCESS;
+    char directory[sizeof(address.sun_path)];
+    char name[64];
+
+    snprintf(name,sizeof(name),"%s",(displayName)?displayName:"");
+    for (char *c = name; *c; c++) {
+        if (!(((*c >= 'a') && (*c <= 'z')) || ((*c >= 'A') && (*c <= 'Z')) || ((*c >= '0') && (*c <= '9'))
+                || ('.' == *c) || ('-' == *c))) {
+            *c = '_';
+        }
+    }
+    error = private_directory(directory,sizeof(directory));
+    if (error != EXIT_SUCCESS) {
+        return error;
+    }
+    memset(&address,0,sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (snprintf(address.sun_path,sizeof(address.sun_path),"%s/" BUS_NAME_FORMAT,directory,name)
+            >= (int)sizeof(address.sun_path)) {
+        syslog(LOG_ERR,"event socket path too long in %s",directory);
+        return ENAMETOOLONG;
+    }
+
+    snprintf(owner,sizeof(owner),"%s",(sessionOwner)?sessionOwner:"???");
+    listenFd = socket(AF_UNIX,SOCK_SEQPACKET|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+    if (-1 == listenFd) {
+        error = errno;
+        syslog(LOG_ERR,"socket error %d (%m)",error);
+    } else {
+        int bound = bind(listenFd,(struct sockaddr *)&address,sizeof(address));
+        if ((bound != 0) && (EADDRINUSE == errno) && (stale_socket())) {
+            unlink(address.sun_path);
+            bound = bind(listenFd,(struct sockaddr *)&address,sizeof(address));
+        }
+        if ((bound != 0) || (listen(listenFd,BUS_MAX_SUBSCRIBERS) != 0)) {
+            error = errno;
+            syslog(LOG_ERR,"cannot listen on %s error %d (%m)",address.sun_path,error);
+            /* not ours to remove */
+            address.sun_path[0] = '\0';
+        } else {
+            error = loop_add(listenFd,POLLIN,on_connection,NULL,"bus");
+        }
+    }
+    if ((error != EXIT_SUCCESS) && (listenFd != -1)) {
+        close(listenFd);
+        listenFd = -1;
+        if (address.sun_path[0]) {
+            unlink(address.sun_path);
+        }
+    }
+    return error;
+}
+
+void bus_close(void)
+{
+    if (listenFd != -1) {
+        /* the events already sent stay readable by the subscribers */
+        while (nbSubscribers) {
+            nbSubscribers--;
+            loop_remove(subscribers[nbSubscribers]);
+            close(subscribers[nbSubscribers]);
+        }
+        loop_remove(listenFd);
+        close(listenFd);
+        listenFd = -1;
+        unlink(address.sun_path);
+    }
+}
+
+void bus_publish(BusEvent event, const char *login)
+{
+    char message[BUS_MAX_MESSAGE];
+    struct timespec now;
+    if (-1 == listenFd) {
+        return;
+    }
+    clock_gettime(CLOCK_REALTIME,&now);
+    int length = snprintf(message,sizeof(message),"%s time=%ld.%03ld pid=%d owner=%s",
+                          eventNames[event],(long)now.tv_sec,now.tv_nsec / 1000000L,(int)getpid(),owner);
+    if ((login) && (length < (int)sizeof(message))) {
+        length += snprintf(message + length,sizeof(message) - length," login=");
+        if (length >= (int)sizeof(message)) {
+            length = sizeof(message) - 1;
+        }
+        /* typed by anybody: one printable word */
+        for (const char *c = login; (*c) && (length < (int)sizeof(message) - 1); c++) {
+            message[length++] = ((*c > ' ') && (*c < 0x7f) && (*c != '='))?*c:'?';
+        }
+        message[length] = '\0';
+    }
+    if (length >= (int)sizeof(message)) {
+        length = sizeof(message) - 1;
+    }
+    if (BusEvent_lock == event) {
+        memcpy(lockMessage,message,length);
+        lockMessageLength = length;
+    }
+    /* backwards as a dropped subscriber is replaced by the last one */
+    for (unsigned int i = nbSubscribers; i > 0; i--) {
+        send_to(i - 1,message,length);
+    }
+}
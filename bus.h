@@ -0,0 +1,48 @@
+/*
+ * bus.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef BUS_H_
+#define BUS_H_
+
+/*
+ * Lock events published while the session is locked on the SOCK_SEQPACKET
+ * socket $XDG_RUNTIME_DIR/xtrlock/<display>.events, <display> being the X
+ * display name with the characters other than letters, digits, '.' and '-'
+ * replaced by '_' (_0.events for :0). The directory is private (0700): only
+ * the user can create or reach the socket, root aside. One datagram per event:
+ *   <event> time=<epoch seconds.ms> pid=<pid> owner=<session owner> [login=<login>]
+ * and a subscriber receives the lock event on connection.
+ * A subscriber whose socket buffer is full is disconnected.
+ */
+#define BUS_DIRECTORY           "xtrlock"
+#define BUS_NAME_FORMAT         "%s.events"
+#define BUS_MAX_SUBSCRIBERS     16
+#define BUS_MAX_MESSAGE         256
+
+#define BUS_EVENT(e)  X(e)
+#define BUS_EVENT_TABLE \
+		BUS_EVENT(lock) \
+		BUS_EVENT(failure) \
+		BUS_EVENT(unlock)
+
+#define X(e)    BusEvent_##e,
+typedef enum BusEvent_ {
+    BUS_EVENT_TABLE
+    BusEventsCount
+} BusEvent;
+#undef X
+
+/* one socket per display: the one left by a dead locker is replaced */
+int bus_open(const char *displayName, const char *owner);
+void bus_close(void);
+void bus_publish(BusEvent event, const char *login);
+
+#endif /* BUS_H_ */
@@ -26,19 +26,27 @@
 #define TO_STRING(x) STRING(x)
 #endif /* STRING */
 
-#define MODE(m)  X(m)
+/* mode, name in the configuration file and in --no */
+#define MODE(m,k)  X(m,k)
 #define MODE_TABLE \
-		MODE(Blank) \
-		MODE(ForkAfter) \
-		MODE(MultiUsers)
+		MODE(Blank,"blank") \
+		MODE(ForkAfter,"fork-after") \
+		MODE(MultiUsers,"multi-user") \
+		MODE(Monitor,"monitor") \
+		MODE(Complete,"complete") \
+		MODE(Diagnostics,"diagnostics") \
+		MODE(Standby,"standby") \
+		MODE(Privacy,"privacy") \
+		MODE(Overlay,"overlay") \
+		MODE(Events,"events")
 
-#define X(m)    ev_##m,
+#define X(m,k)    ev_##m,
 typedef enum ModeBitValue_ {
     MODE_TABLE
 } ModeBitValue;
 #undef X
 
-#define X(m)    e_##m = 1<<ev_##m,
+#define X(m,k)    e_##m = 1<<ev_##m,
 typedef enum ModeValue_ {
     MODE_TABLE
 } ModeValue;
@@ -51,14 +59,27 @@ typedef enum ModeValue_ {
 
 #define CMDLINE_OPTS_TABLE \
                 O(blank,b," :blank screen.",NO_ARG) \
+                O(privacy,p," :pixelated copy of the screen as background," EOL NLT "visible but unreadable",NO_ARG) \
+                O(overlay,o," :show the session owner, lock time, elapsed time" EOL NLT "and failed attempts (implies -b without -p)",NO_ARG) \
                 O(fork-after,f," :detach the program from the caller.",NO_ARG) \
                 O(multi-user,u," :ask user name before password to allow unlock" EOL NLT "accountability on a generic user session",NO_ARG) \
+                O(standby,s," :keep a standby locker ready to take over the grabs" EOL NLT "if this one dies",NO_ARG) \
+                O(complete,c," :complete the login name with the Tab key in multi-user" EOL NLT "mode (reveals the valid login names)",NO_ARG) \
+                O(diagnostics,d," :account wakeups, X traffic, syscalls and CPU time" EOL NLT "per lock phase, the summary is logged at unlock",NO_ARG) \
+                O(wakeup-budget,w," N :wakeups per minute allowed while idle" EOL NLT "(implies --diagnostics)",NEED_ARG) \
+                O(config,C," FILE :configuration file, reloaded when it changes" EOL NLT "(default " DEFAULT_CONFIG_FILE ")",NEED_ARG) \
+                O(events,e," :publish lock, failure and unlock events to the" EOL NLT "subscribers of $XDG_RUNTIME_DIR/xtrlock/<display>.events",NO_ARG) \
+                O(monitor,m," :publish the lock state in a shared memory page" EOL NLT "for monitoring agents",NO_ARG) \
+                O(no,n," MODES :comma separated modes turned off whatever the" EOL NLT "configuration file says (e.g. --no=privacy,events)",NEED_ARG) \
 				O(help,h,": Print this help message and exit.",NO_ARG) \
 				O(version,v,": Print the version number of xtrlock and exit.",NO_ARG)
 
 typedef struct cmndline_parameters_ {
     unsigned int modes;
+    unsigned int modesSet;  /* given on the command line, on or off */
     unsigned int timeout;
+    unsigned int wakeupBudget;
+    const char *configFile;
 } cmndline_parameters;
 
 
@@ -0,0 +1,218 @@
+/*
+ * completion.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#define _GNU_SOURCE /* qsort_r */
+#include <stdlib.h>
+#include <errno.h>
+#include <pwd.h>
+#include <syslog.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "completion.h"
+
+/* all the names in one pool, the index holds their sorted offsets */
+struct CompletionIndex_ {
+    char *pool;
+    size_t poolSize;
+    uint32_t *names;
+    size_t nbNames;
+};
+
+/* the index in use, only touched by the event loop */
+static CompletionIndex *current = NULL;
+static const CompletionIndex empty = { NULL, 0, NULL, 0 };
+
+static inline const CompletionIndex *in_use(void)
+{
+    return (current)?current:&empty;
+}
+
+static inline const char *name_at(const CompletionIndex *index, size_t i)
+{
+    return index->pool + index->names[i];
+}
+
+static int compare_names(const void *a, const void *b, void *data)
+{
+    const char *pool = (const char *)data;
+    return strcmp(pool + *(const uint32_t *)a,pool + *(const uint32_t *)b);
+}
+
+static int is_login_shell(const char *shell)
+{
+    static const char *const denied[] = { "nologin", "false" };
+    const char *base = strrchr(shell,'/');
+    base = (base)?base + 1:shell;
+    if ('\0' == *base) {
+        return 1; /* empty shell means /bin/sh */
+    }
+    for (register size_t i = 0; i < sizeof(denied)/sizeof(denied[0]); i++) {
+        if (strcmp(base,denied[i]) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int add_name(CompletionIndex *index, const char *name, size_t *poolCapacity, size_t *namesCapacity)
+{
+    const size_t length = strlen(name) + 1;
+    if (index->poolSize + length > *poolCapacity) {
+        char *p = realloc(index->pool,*poolCapacity * 2 + length);
+        if (NULL == p) {
+            return ENOMEM;
+        }
+        index->pool = p;
+        *poolCapacity = *poolCapacity * 2 + length;
+    }
+    if (index->nbNames == *namesCapacity) {
+        uint32_t *n = realloc(index->names,*namesCapacity * 2 * sizeof(*index->names));
+        if (NULL == n) {
+            return ENOMEM;
+        }
+        index->names = n;
+        *namesCapacity *= 2;
+    }
+    memcpy(index->pool + index->poolSize,name,length);
+    index->names[index->nbNames++] = index->poolSize;
+    index->poolSize += length;
+    return EXIT_SUCCESS;
+}
+
+CompletionIndex *completion_index_build(char *const *allowed, size_t count)
+{
+    int error = EXIT_SUCCESS;
+    size_t poolCapacity = 4096;
+    size_t namesCapacity = 256;
+    CompletionIndex *index = calloc(1,sizeof(CompletionIndex));
+
+    if (index) {
+        index->pool = malloc(poolCapacity);
+        index->names = malloc(namesCapacity * sizeof(*index->names));
+    }
+    if ((NULL == index) || (NULL == index->pool) || (NULL == index->names)) {
+        completion_index_free(index);
+        return NULL;
+    }
+
+    if (count > 0) {
+        for (register size_t i = 0; (i < count) && (EXIT_SUCCESS == error); i++) {
+            error = add_name(index,allowed[i],&poolCapacity,&namesCapacity);
+        }
+    } else {
+        /* only the builder thread enumerates the accounts */
+        const struct passwd *pw;
+        setpwent();
+        while ((EXIT_SUCCESS == error) && ((pw = getpwent()) != NULL)) {
+            if (is_login_shell(pw->pw_shell)) {
+                error = add_name(index,pw->pw_name,&poolCapacity,&namesCapacity);
+            }
+        }
+        endpwent();
+    }
+
+    if (EXIT_SUCCESS == error) {
+        qsort_r(index->names,index->nbNames,sizeof(*index->names),compare_names,index->pool);
+        /* NSS may return the same name from several sources */
+        size_t n = 0;
+        for (register size_t i = 0; i < index->nbNames; i++) {
+            if ((0 == n) || (strcmp(name_at(index,i),name_at(index,n - 1)) != 0)) {
+                index->names[n++] = index->names[i];
+            }
+        }
+        index->nbNames = n;
+        syslog(LOG_DEBUG,"%zu login names indexed for completion",index->nbNames);
+    } else {
+        syslog(LOG_ERR,"login names index error %d",error);
+        completion_index_free(index);
+        index = NULL;
+    }
+    return index;
+}
+
+void completion_index_free(CompletionIndex *index)
+{
+    if (index) {
+        free(index->names);
+        free(index->pool);
+        free(index);
+    }
+}
+
+void completion_install(CompletionIndex *index)
+{
+    completion_index_free(current);
+    current = index;
+}
+
+int completion_build(char *const *allowed, size_t count)
+{
+    CompletionIndex *index = completion_index_build(allowed,count);
+    completion_install(index);
+    return (index)?EXIT_SUCCESS:ENOMEM;
+}
+
+void completion_free(void)
+{
+    completion_install(NULL);
+}
+
+/* first name not lower than prefix */
+static size_t lower_bound(const CompletionIndex *index, const char *prefix, size_t length)
+{
+    size_t low = 0, high = index->nbNames;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (strncmp(name_at(index,middle),prefix,length) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/* first name after the ones starting with prefix */
+static size_t upper_bound(const CompletionIndex *index, const char *prefix, size_t length, size_t low)
+{
+    size_t high = index->nbNames;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (strncmp(name_at(index,middle),prefix,length) <= 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+size_t completion_count(const char *prefix, size_t length)
+{
+    const CompletionIndex *index = in_use();
+    const size_t first = lower_bound(index,prefix,length);
+    return upper_bound(index,prefix,length,first) - first;
+}
+
+size_t completion_complete(char *prefix, size_t *length, size_t size)
+{
+    const CompletionIndex *index = in_use();
+    const size_t first = lower_bound(index,prefix,*length);
+    const size_t last = upper_bound(index,prefix,*length,first);
+    if (first < last) {
+        /* sorted: the common part of the range is the one of its bounds */
+        const char *a = name_at(index,first);
+        const char *b = name_at(index,last - 1);
+        size_t n = *length;
+        while ((a[n] != '\0') && (a[n] == b[n]) && (n < size - 1)) {
+            prefix[n] = a[n];
+            n++;
+        }
+        *length = n;
+    }
+    return last - first;
+}
@@ -0,0 +1,36 @@
+/*
+ * completion.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef COMPLETION_H_
+#define COMPLETION_H_
+
+#include <stddef.h>
+
+/* Sorted index of the login names allowed to unlock, built once at lock time:
+ * the allowed list if any, else the accounts having a login shell */
+int completion_build(char *const *allowed, size_t count);
+void completion_free(void);
+
+/* The same in two steps: the build, which may enumerate the accounts through
+ * NSS, can run in another thread; the index is installed by the event loop */
+typedef struct CompletionIndex_ CompletionIndex;
+CompletionIndex *completion_index_build(char *const *allowed, size_t count);
+void completion_index_free(CompletionIndex *index);
+void completion_install(CompletionIndex *index);
+
+/* Number of login names starting with prefix */
+size_t completion_count(const char *prefix, size_t length);
+
+/* Extend prefix to the longest part common to all the matching login names,
+ * return the number of matches */
+size_t completion_complete(char *prefix, size_t *length, size_t size);
+
+#endif /* COMPLETION_H_ */
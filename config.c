@@ -0,0 +1,478 @@
+/*
+ * config.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <libgen.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "cmdline_parameters.h"
+#include "config.h"
+#include "diag.h"
+#include "loop.h"
+
+static LockConfig *config = NULL;
+static char *configPath = NULL;
+static int inotifyFd = -1;
+static int reloadTimer = -1;
+static ConfigChangedHandler changedHandler = NULL;
+static ConfigPrepareHandler prepareHandler = NULL;
+
+/* reload worker: parses the file off the input path, the loop swaps the result in */
+static pthread_t reloadThread;
+static Bool reloading = False;
+static Bool reloadAgain = False;    /* changed again while parsing */
+static int reloadNotify[2] = { -1, -1 };
+static int reloadError = EXIT_SUCCESS;
+static LockConfig *reloadParsed = NULL;
+static void *reloadPrepared = NULL;
+
+static const LockConfig defaultConfig = {
+    .modes = 0x0,
+    .modesSet = 0x0,
+    .wakeupBudget = WAKEUP_BUDGET_NOT_SET,
+    .timeoutPerAttempt = TIMEOUTPERATTEMPT,
+    .maxGoodwill = MAXGOODWILL,
+    .goodwillPortion = GOODWILLPORTION,
+    .backend = authenticate,
+    .allowedUsers = NULL,
+    .nbAllowedUsers = 0,
+    .credentialCache = NULL,
+    .cacheMode = CredCacheOff,
+    .preLockHooks = NULL,
+    .postUnlockHooks = NULL,
+    .hookTimeout = HOOK_TIMEOUT,
+    .hookKill = HookKillTerm
+};
+
+static void free_config(LockConfig *c)
+{
+    if (c) {
+        for (register size_t i = 0; i < c->nbAllowedUsers; i++) {
+            free(c->allowedUsers[i]);
+        }
+        free(c->allowedUsers);
+        free(c->credentialCache);
+        free(c->preLockHooks);
+        free(c->postUnlockHooks);
+        free(c);
+    }
+}
+
+static int compare_logins(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a,*(char *const *)b);
+}
+
+static int parse_bool(const char *value, int *b)
+{
+    int error = EXIT_SUCCESS;
+    if ((strcasecmp(value,"yes") == 0) || (strcasecmp(value,"true") == 0) || (strcmp(value,"1") == 0)) {
+        *b = 1;
+    } else if ((strcasecmp(value,"no") == 0) || (strcasecmp(value,"false") == 0) || (strcmp(value,"0") == 0)) {
+        *b = 0;
+    } else {
+        error = EINVAL;
+    }
+    return error;
+}
+
+static int parse_long(const char *value, long min, long max, long *l)
+{
+    char *end = NULL;
+    errno = 0;
+    const long v = strtol(value,&end,10);
+    if ((errno != 0) || (end == value) || (*end != '\0') || (v < min) || (v > max)) {
+        return EINVAL;
+    }
+    *l = v;
+    return EXIT_SUCCESS;
+}
+
+/* an empty value resets the path */
+static int parse_path(const char *value, char **path)
+{
+    free(*path);
+    *path = NULL;
+    if (*value != '\0') {
+        *path = strdup(value);
+        if (NULL == *path) {
+            return ENOMEM;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static int parse_users(char *value, LockConfig *c)
+{
+    int error = EXIT_SUCCESS;
+    char *saveptr = NULL;
+    for (char *login = strtok_r(value,", \t",&saveptr); (login) && (EXIT_SUCCESS == error); login = strtok_r(NULL,", \t",&saveptr)) {
+        char **users = realloc(c->allowedUsers,(c->nbAllowedUsers + 1) * sizeof(char *));
+        if (users) {
+            c->allowedUsers = users;
+            users[c->nbAllowedUsers] = strdup(login);
+            if (users[c->nbAllowedUsers]) {
+                c->nbAllowedUsers++;
+            } else {
+                error = ENOMEM;
+            }
+        } else {
+            error = ENOMEM;
+        }
+    }
+    qsort(c->allowedUsers,c->nbAllowedUsers,sizeof(char *),compare_logins);
+    return error;
+}
+
+#define MODE_KEY(k,m) \
+    else if (strcmp(key,k) == 0) { \
+        int b = 0; \
+        error = parse_bool(value,&b); \
+        if (b) c->modes |= m; else c->modes &= ~m; \
+        c->modesSet |= m; \
+    }
+
+static int parse_line(char *key, char *value, LockConfig *c)
+{
+    int error = EXIT_SUCCESS;
+    long l = 0;
+    if (0) {
+    }
+#define X(m,k) MODE_KEY(k,e_##m)
+    MODE_TABLE
+#undef X
+    else if (strcmp(key,"wakeup-budget") == 0) {
+        error = parse_long(value,0,INT_MAX,&l);
+        c->wakeupBudget = l;
+    } else if (strcmp(key,"timeout-per-attempt") == 0) {
+        error = parse_long(value,0,LONG_MAX/8,&c->timeoutPerAttempt);
+    } else if (strcmp(key,"max-goodwill") == 0) {
+        error = parse_long(value,0,LONG_MAX/8,&c->maxGoodwill);
+    } else if (strcmp(key,"goodwill-portion") == 0) {
+        char *end = NULL;
+        c->goodwillPortion = strtod(value,&end);
+        if ((end == value) || (*end != '\0') || (c->goodwillPortion < 0.0) || (c->goodwillPortion > 1.0)) {
+            error = EINVAL;
+        }
+    } else if (strcmp(key,"allowed-users") == 0) {
+        error = parse_users(value,c);
+    } else if (strcmp(key,"auth-backend") == 0) {
+        if (strcmp(value,"pam") == 0) {
+            c->backend = auth_pam;
+        } else if (strcmp(value,"shadow") == 0) {
+            c->backend = auth_shadow;
+        } else {
+            error = EINVAL;
+        }
+    } else if (strcmp(key,"credential-cache") == 0) {
+        error = parse_path(value,&c->credentialCache);
+    } else if (strcmp(key,"credential-cache-mode") == 0) {
+        if (strcmp(value,"first") == 0) {
+            c->cacheMode = CredCacheFirst;
+        } else if (strcmp(value,"fallback") == 0) {
+            c->cacheMode = CredCacheFallback;
+        } else {
+            error = EINVAL;
+        }
+    } else if (strcmp(key,"pre-lock-hooks") == 0) {
+        error = parse_path(value,&c->preLockHooks);
+    } else if (strcmp(key,"post-unlock-hooks") == 0) {
+        error = parse_path(value,&c->postUnlockHooks);
+    } else if (strcmp(key,"hook-timeout") == 0) {
+        error = parse_long(value,1,INT_MAX,&l);
+        c->hookTimeout = l;
+    } else if (strcmp(key,"hook-kill") == 0) {
+        if (strcmp(value,"term") == 0) {
+            c->hookKill = HookKillTerm;
+        } else if (strcmp(value,"kill") == 0) {
+            c->hookKill = HookKillKill;
+        } else if (strcmp(value,"leave") == 0) {
+            c->hookKill = HookKillLeave;
+        } else {
+            error = EINVAL;
+        }
+    } else {
+        error = ENOENT;
+    }
+    return error;
+}
+#undef MODE_KEY
+
+static inline char *trim(char *s)
+{
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while ((end > s) && (isspace((unsigned char)end[-1]))) end--;
+    *end = '\0';
+    return s;
+}
+
+static int parse_file(const char *path, Bool mustExist, LockConfig **parsed)
+{
+    int error = EXIT_SUCCESS;
+    LockConfig *c = malloc(sizeof(LockConfig));
+    if (NULL == c) {
+        return ENOMEM;
+    }
+    *c = defaultConfig;
+
+    FILE *f = fopen(path,"re");
+    if (f) {
+        char *line = NULL;
+        size_t size = 0;
+        unsigned int lineNumber = 0;
+        while ((EXIT_SUCCESS == error) && (getline(&line,&size,f) != -1)) {
+            lineNumber++;
+            char *comment = strchr(line,'#');
+            if (comment) {
+                *comment = '\0';
+            }
+            char *key = trim(line);
+            if ('\0' == *key) {
+                continue;
+            }
+            char *equal = strchr(key,'=');
+            if (equal) {
+                *equal = '\0';
+                error = parse_line(trim(key),trim(equal + 1),c);
+            } else {
+                error = EINVAL;
+            }
+            if (error != EXIT_SUCCESS) {
+                syslog(LOG_ERR,"%s:%u: invalid setting (error %d)",path,lineNumber,error);
+            }
+        }
+        free(line);
+        struct stat st;
+        if (((c->preLockHooks) || (c->postUnlockHooks))
+                && ((fstat(fileno(f),&st) != 0) || (st.st_uid != 0) || (st.st_mode & (S_IWGRP|S_IWOTH)))) {
+            /* anybody can give a file with -C: no command from a file root does not control */
+            syslog(LOG_ERR,"%s: hooks ignored, the file must be owned by root and not writable by group and others",path);
+            free(c->preLockHooks);
+            free(c->postUnlockHooks);
+            c->preLockHooks = c->postUnlockHooks = NULL;
+        }
+        fclose(f);
+        if (NULL == c->credentialCache) {
+            c->cacheMode = CredCacheOff;
+        } else if (CredCacheOff == c->cacheMode) {
+            c->cacheMode = CredCacheFallback;
+        }
+    } else if ((errno != ENOENT) || (mustExist)) {
+        error = errno;
+        syslog(LOG_ERR,"cannot read the configuration file %s (%m)",path);
+    }
+
+    if (EXIT_SUCCESS == error) {
+        *parsed = c;
+    } else {
+        free_config(c);
+    }
+    return error;
+}
+
+int config_load(const char *path)
+{
+    const Bool mustExist = (path != NULL);
+    LockConfig *parsed = NULL;
+    if (NULL == path) {
+        path = DEFAULT_CONFIG_FILE;
+    }
+    free(configPath);
+    configPath = strdup(path);
+    int error = (configPath)?parse_file(configPath,mustExist,&parsed):ENOMEM;
+    if (EXIT_SUCCESS == error) {
+        free_config(config);
+        config = parsed;
+    }
+    return error;
+}
+
+/* config and configPath are not changed by the loop while it runs */
+static void *reload_worker(void *data)
+{
+    const char done = 0;
+    reloadParsed = NULL;
+    reloadPrepared = NULL;
+    reloadError = parse_file(configPath,True,&reloadParsed);
+    if ((EXIT_SUCCESS == reloadError) && (prepareHandler)) {
+        reloadPrepared = prepareHandler(config,reloadParsed);
+    }
+    if (write(reloadNotify[1],&done,sizeof(done)) != sizeof(done)) {
+        syslog(LOG_ERR,"reload notification error %d (%m)",errno);
+    }
+    return NULL;
+}
+
+/* wait for the worker, the results are then owned by the loop */
+static void join_reload(void)
+{
+    char buffer[16];
+    pthread_join(reloadThread,NULL);
+    while (read(reloadNotify[0],buffer,sizeof(buffer)) > 0);
+    reloading = False;
+}
+
+static void on_reload_done(int fd, short revents, void *data)
+{
+    if (!reloading) {
+        return;
+    }
+    join_reload();
+    if (EXIT_SUCCESS == reloadError) {
+        LockConfig *previous = config;
+        if (previous && (reloadParsed->modes != previous->modes)) {
+            syslog(LOG_WARNING,"%s: the mode changes will be applied by the next lock",configPath);
+        }
+        config = reloadParsed;
+        if (changedHandler) {
+            changedHandler(previous,config,reloadPrepared);
+        }
+        free_config(previous);
+        syslog(LOG_NOTICE,"%s reloaded",configPath);
+    } else {
+        syslog(LOG_WARNING,"%s: keeping the current configuration",configPath);
+    }
+    reloadParsed = NULL;
+    reloadPrepared = NULL;
+    if (reloadAgain) {
+        reloadAgain = False;
+        loop_arm_timer(reloadTimer,CONFIG_RELOAD_DELAY_MS,False);
+    }
+}
+
+static void on_reload_timer(int fd, short revents, void *data)
+{
+    uint64_t expirations;
+    if (read(fd,&expirations,sizeof(expirations)) != sizeof(expirations)) {
+        return;
+    }
+    if (reloading) {
+        /* parsed again once the current reload is done */
+        reloadAgain = True;
+        return;
+    }
+    const int error = pthread_create(&reloadThread,NULL,reload_worker,NULL);
+    if (EXIT_SUCCESS == error) {
+        reloading = True;
+    } else {
+        syslog(LOG_ERR,"%s: reload thread error %d (%s), keeping the current configuration",
+               configPath,error,strerror(error));
+    }
+}
+
+static void on_inotify(int fd, short revents, void *data)
+{
+    char buffer[sizeof(struct inotify_event) + NAME_MAX + 1] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    char *pathCopy = strdupa(configPath);
+    const char *name = basename(pathCopy);
+    Bool changed = False;
+    ssize_t n;
+
+    while ((n = read(fd,buffer,sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + n; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if ((event->len > 0) && (strcmp(event->name,name) == 0)) {
+                changed = True;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    if (changed) {
+        /* editors write in several steps: parse once they are done */
+        loop_arm_timer(reloadTimer,CONFIG_RELOAD_DELAY_MS,False);
+    }
+}
+
+int config_watch(ConfigPrepareHandler prepare, ConfigChangedHandler handler)
+{
+    int error = EXIT_SUCCESS;
+    prepareHandler = prepare;
+    changedHandler = handler;
+    if (pipe2(reloadNotify,O_NONBLOCK|O_CLOEXEC) != 0) {
+        error = errno;
+        syslog(LOG_ERR,"pipe error %d (%m)",error);
+        return error;
+    }
+    loop_add(reloadNotify[0],POLLIN,on_reload_done,NULL,"config");
+    inotifyFd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+    if (inotifyFd != -1) {
+        /* watch the directory to follow the files replaced by rename */
+        char *pathCopy = strdupa(configPath);
+        const char *directory = dirname(pathCopy);
+        if (inotify_add_watch(inotifyFd,directory,IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE) != -1) {
+            reloadTimer = loop_add_timer(0,False,on_reload_timer,NULL,"config");
+            error = loop_add(inotifyFd,POLLIN,on_inotify,NULL,"config");
+        } else {
+            error = errno;
+            /* no configuration directory, nothing to reload */
+            syslog(((ENOENT == error) && (strcmp(configPath,DEFAULT_CONFIG_FILE) == 0))?LOG_DEBUG:LOG_ERR,
+                   "cannot watch %s (%m)",directory);
+            close(inotifyFd);
+            inotifyFd = -1;
+        }
+    } else {
+        error = errno;
+        syslog(LOG_ERR,"inotify_init1 error %d (%m)",error);
+    }
+    return error;
+}
+
+void config_free(void)
+{
+    if (inotifyFd != -1) {
+        loop_remove(inotifyFd);
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    loop_remove_timer(reloadTimer);
+    reloadTimer = -1;
+    if (reloading) {
+        join_reload();
+        free_config(reloadParsed);
+        reloadParsed = NULL;
+        if (changedHandler) {
+            /* not applied: only the prepared data is released */
+            changedHandler(NULL,NULL,reloadPrepared);
+        }
+        reloadPrepared = NULL;
+    }
+    if (reloadNotify[0] != -1) {
+        loop_remove(reloadNotify[0]);
+        close(reloadNotify[0]);
+        close(reloadNotify[1]);
+        reloadNotify[0] = reloadNotify[1] = -1;
+    }
+    free_config(config);
+    config = NULL;
+    free(configPath);
+    configPath = NULL;
+}
+
+const LockConfig *config_get(void)
+{
+    return (config)?config:&defaultConfig;
+}
+
+int config_user_allowed(const LockConfig *c, const char *login)
+{
+    return (0 == c->nbAllowedUsers)
+           || (bsearch(&login,c->allowedUsers,c->nbAllowedUsers,sizeof(char *),compare_logins) != NULL);
+}
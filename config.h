@@ -0,0 +1,87 @@
+/*
+ * config.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stddef.h>
+#include "auth.h"
+#include "credcache.h"
+#include "hooks.h"
+
+#ifndef SYSCONFDIR
+#define SYSCONFDIR "/etc"
+#endif /* SYSCONFDIR */
+
+/* a directory of its own: the reloads watch the directory of the file */
+#define DEFAULT_CONFIG_DIR  SYSCONFDIR "/xtrlock.d"
+#define DEFAULT_CONFIG_FILE DEFAULT_CONFIG_DIR "/xtrlock.conf"
+
+/* delay between the last change of the file and its parsing */
+#define CONFIG_RELOAD_DELAY_MS 200
+
+#define TIMEOUTPERATTEMPT 30000
+#define MAXGOODWILL  (TIMEOUTPERATTEMPT*5)
+#define INITIALGOODWILL MAXGOODWILL
+#define GOODWILLPORTION 0.3
+
+/*
+ * key = value lines, # starts a comment:
+ * blank, privacy, overlay, fork-after, multi-user, complete, diagnostics, monitor, events, standby: yes|no
+ * (startup only, for the modes which are not given on the command line)
+ * wakeup-budget: wakeups per minute (startup only)
+ * timeout-per-attempt, max-goodwill: ms
+ * goodwill-portion: 0.0 to 1.0
+ * allowed-users: comma or space separated login names, empty for everybody (multi-user mode)
+ * auth-backend: pam|shadow
+ * credential-cache: path of the offline credential cache
+ * credential-cache-mode: first|fallback (default fallback)
+ * pre-lock-hooks, post-unlock-hooks: hook or directory of hooks
+ * hook-timeout: ms (default 5000)
+ * hook-kill: term|kill|leave (default term)
+ */
+typedef struct LockConfig_ {
+    unsigned int modes;
+    unsigned int modesSet;  /* given in the file, yes or no */
+    unsigned int wakeupBudget;
+    long timeoutPerAttempt;
+    long maxGoodwill;
+    double goodwillPortion;
+    AuthBackend backend;
+    char **allowedUsers;    /* sorted */
+    size_t nbAllowedUsers;
+    char *credentialCache;
+    CredCacheMode cacheMode;
+    char *preLockHooks;
+    char *postUnlockHooks;
+    unsigned int hookTimeout;
+    HookKillPolicy hookKill;
+} LockConfig;
+
+/* called by the reload thread with the new configuration, returns data built
+ * off the input path (may be NULL) which is handed to the changed handler */
+typedef void *(*ConfigPrepareHandler)(const LockConfig *previous, const LockConfig *parsed);
+/* called by the event loop once the new configuration is in use; current is
+ * NULL if it is dropped at exit and prepared must only be released */
+typedef void (*ConfigChangedHandler)(const LockConfig *previous, const LockConfig *current, void *prepared);
+
+/* parse the file (missing file allowed if the path is the default one) */
+int config_load(const char *path);
+/* watch the directory of the file with inotify, parse the changed file in a
+ * worker thread and apply it from the event loop */
+int config_watch(ConfigPrepareHandler prepare, ConfigChangedHandler handler);
+void config_free(void);
+
+/* current configuration, replaced as a whole by a reload */
+const LockConfig *config_get(void);
+int config_user_allowed(const LockConfig *config, const char *login);
+
+#endif /* CONFIG_H_ */
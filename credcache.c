@@ -0,0 +1,177 @@
+/*
+ * credcache.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <string.h>
+#include <crypt.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "credcache.h"
+
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static char *cachePath = NULL;
+static const CredCacheHeader *cache = NULL;
+static size_t cacheSize = 0;
+static struct stat cacheStat;
+
+static void unmap_cache(void)
+{
+    if (cache) {
+        munmap((void *)cache,cacheSize);
+        cache = NULL;
+        cacheSize = 0;
+    }
+}
+
+int credcache_set_path(const char *path)
+{
+    int error = EXIT_SUCCESS;
+    pthread_mutex_lock(&cacheLock);
+    if ((NULL == path) || (NULL == cachePath) || (strcmp(path,cachePath) != 0)) {
+        unmap_cache();
+        free(cachePath);
+        cachePath = NULL;
+        if (path) {
+            cachePath = strdup(path);
+            if (NULL == cachePath) {
+                error = ENOMEM;
+            }
+        }
+    }
+    pthread_mutex_unlock(&cacheLock);
+    return error;
+}
+
+static inline int same_file(const struct stat *a, const struct stat *b)
+{
+    return (a->st_dev == b->st_dev) && (a->st_ino == b->st_ino)
+           && (a->st_size == b->st_size)
+           && (a->st_mtim.tv_sec == b->st_mtim.tv_sec) && (a->st_mtim.tv_nsec == b->st_mtim.tv_nsec);
+}
+
+/* (re)map the file if it has been replaced, called with cacheLock held */
+static int map_cache(void)
+{
+    int error = EXIT_SUCCESS;
+    struct stat st;
+
+    if (NULL == cachePath) {
+        return EAGAIN;
+    }
+    if (stat(cachePath,&st) != 0) {
+        error = errno;
+        syslog(LOG_ERR,"credential cache %s unavailable (%m)",cachePath);
+        unmap_cache();
+        return EAGAIN;
+    }
+    if ((cache) && (same_file(&st,&cacheStat))) {
+        return EXIT_SUCCESS;
+    }
+    unmap_cache();
+
+    const int fd = open(cachePath,O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+    if (fd != -1) {
+        if ((fstat(fd,&st) == 0) && (S_ISREG(st.st_mode))) {
+            if ((st.st_uid != 0) || (st.st_mode & (S_IWGRP|S_IWOTH))) {
+                error = EPERM;
+                syslog(LOG_ERR,"credential cache %s must be owned by root and not writable by others",cachePath);
+            } else if (st.st_size < (off_t)sizeof(CredCacheHeader)) {
+                error = EINVAL;
+            } else {
+                void *p = mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+                if (p != MAP_FAILED) {
+                    const CredCacheHeader *header = (const CredCacheHeader *)p;
+                    if ((memcmp(header->magic,CREDCACHE_MAGIC,sizeof(header->magic)) == 0)
+                            && (CREDCACHE_VERSION == header->version)
+                            && ((size_t)st.st_size == sizeof(CredCacheHeader) + header->count * sizeof(CredCacheEntry))) {
+                        cache = header;
+                        cacheSize = st.st_size;
+                        cacheStat = st;
+                    } else {
+                        error = EINVAL;
+                        munmap(p,st.st_size);
+                    }
+                } else {
+                    error = errno;
+                }
+            }
+        } else {
+            error = EINVAL;
+        }
+        close(fd);
+    } else {
+        error = errno;
+    }
+
+    if (error != EXIT_SUCCESS) {
+        syslog(LOG_ERR,"credential cache %s is not usable (error %d)",cachePath,error);
+        error = EAGAIN;
+    }
+    return error;
+}
+
+static int compare_entry(const void *key, const void *entry)
+{
+    return strncmp((const char *)key,((const CredCacheEntry *)entry)->login,CREDCACHE_LOGIN_SIZE);
+}
+
+int auth_credcache(const UserAuthenticationData *userData)
+{
+    int error = EXIT_SUCCESS;
+    char hash[CREDCACHE_HASH_SIZE];
+
+    pthread_mutex_lock(&cacheLock);
+    error = map_cache();
+    if (EXIT_SUCCESS == error) {
+        const CredCacheEntry *entry = bsearch(userData->login,cache + 1,cache->count,sizeof(CredCacheEntry),compare_entry);
+        if (entry) {
+            /* copied: the mapping may be replaced once the lock is released */
+            memcpy(hash,entry->hash,sizeof(hash));
+            hash[sizeof(hash) - 1] = '\0';
+        } else {
+            error = ENOENT;
+        }
+    }
+    pthread_mutex_unlock(&cacheLock);
+
+    if (EXIT_SUCCESS == error) {
+        struct crypt_data *data = calloc(1,sizeof(struct crypt_data));
+        if (data) {
+            const char *pwdhash = crypt_r(userData->password,hash,data);
+            if ((NULL == pwdhash) || ('*' == pwdhash[0])) {
+                error = EINVAL;
+                syslog(LOG_ERR,"crypt error for cached user %s",userData->login);
+            } else if (!auth_equal(pwdhash,hash)) {
+                error = EINVAL;
+                syslog(LOG_ERR,"invalid password for cached user %s",userData->login);
+            }
+            explicit_bzero(data,sizeof(struct crypt_data));
+            free(data);
+        } else {
+            error = ENOMEM;
+        }
+    } else if (ENOENT == error) {
+        syslog(LOG_ERR,"user %s is not in the credential cache",userData->login);
+    }
+    return error;
+}
+
+int auth_credcache_pam(const UserAuthenticationData *userData)
+{
+    int error = auth_credcache(userData);
+    if (EXIT_SUCCESS == error) {
+        /* expired or locked accounts, access rules... still apply */
+        error = auth_pam_account(userData);
+    }
+    return error;
+}
@@ -0,0 +1,58 @@
+/*
+ * credcache.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef CREDCACHE_H_
+#define CREDCACHE_H_
+
+#include <stdint.h>
+#include "auth.h"
+
+/*
+ * Offline credential cache: root owned file, not writable by group and
+ * others, made of a header followed by fixed size entries sorted by login.
+ * It is written out of band by xtrlock-mkcache and replaced by rename.
+ */
+#define CREDCACHE_DEFAULT_PATH  "/var/cache/xtrlock/credentials"
+#define CREDCACHE_MAGIC         "XTRLKCC1"
+#define CREDCACHE_VERSION       1
+#define CREDCACHE_LOGIN_SIZE    64
+#define CREDCACHE_HASH_SIZE     192
+
+typedef struct CredCacheHeader_ {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t generated; /* time(2) */
+} CredCacheHeader;
+
+typedef struct CredCacheEntry_ {
+    char login[CREDCACHE_LOGIN_SIZE];
+    char hash[CREDCACHE_HASH_SIZE];
+} CredCacheEntry;
+
+typedef enum CredCacheMode_ {
+    CredCacheOff,
+    CredCacheFirst,     /* tried before the backend which runs if it fails; a hit
+                         * skips the authentication modules of PAM (other factors
+                         * included) but not its account checks */
+    CredCacheFallback   /* used when the backend is unavailable */
+} CredCacheMode;
+
+/* file to use, NULL to stop using it */
+int credcache_set_path(const char *path);
+
+/* verify the password against the cache, no NSS call;
+ * ENOENT if the login is not cached, EAGAIN if there is no usable cache */
+int auth_credcache(const UserAuthenticationData *userData);
+/* auth_credcache then, on a hit, auth_pam_account */
+int auth_credcache_pam(const UserAuthenticationData *userData);
+
+#endif /* CREDCACHE_H_ */
@@ -0,0 +1,242 @@
+/*
+ * diag.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "diag.h"
+#include "loop.h"
+
+#ifndef TO_STRING
+#define STRING(x) #x
+#define TO_STRING(x) STRING(x)
+#endif /* STRING */
+
+typedef struct DiagCounters_ {
+    unsigned long wakeups;
+    unsigned long events;
+    unsigned long requests;
+    unsigned long roundTrips;
+    unsigned long readSyscalls;
+    unsigned long writeSyscalls;
+    unsigned long contextSwitches;
+    uint64_t cpu;   /* ns */
+    uint64_t wall;  /* ns */
+    unsigned long sources[LOOP_MAX_STATS];  /* wakeups by loop source */
+} DiagCounters;
+
+static Display *diagDisplay = NULL;
+static unsigned int budget = WAKEUP_BUDGET_NOT_SET;
+static DiagPhase currentPhase = PhaseAcquiring;
+static DiagCounters totals[PhasesCount];
+static DiagCounters phaseStart;
+static unsigned long eventsByType[LASTEvent];
+static unsigned long events = 0;
+static unsigned long roundTrips = 0;
+
+static const char *const eventNames[LASTEvent] = {
+    [KeyPress] = "KeyPress", [KeyRelease] = "KeyRelease",
+    [ButtonPress] = "ButtonPress", [ButtonRelease] = "ButtonRelease",
+    [MotionNotify] = "MotionNotify", [EnterNotify] = "EnterNotify",
+    [LeaveNotify] = "LeaveNotify", [FocusIn] = "FocusIn", [FocusOut] = "FocusOut",
+    [KeymapNotify] = "KeymapNotify", [Expose] = "Expose",
+    [GraphicsExpose] = "GraphicsExpose", [NoExpose] = "NoExpose",
+    [VisibilityNotify] = "VisibilityNotify", [CreateNotify] = "CreateNotify",
+    [DestroyNotify] = "DestroyNotify", [UnmapNotify] = "UnmapNotify",
+    [MapNotify] = "MapNotify", [MapRequest] = "MapRequest",
+    [ReparentNotify] = "ReparentNotify", [ConfigureNotify] = "ConfigureNotify",
+    [ConfigureRequest] = "ConfigureRequest", [GravityNotify] = "GravityNotify",
+    [ResizeRequest] = "ResizeRequest", [CirculateNotify] = "CirculateNotify",
+    [CirculateRequest] = "CirculateRequest", [PropertyNotify] = "PropertyNotify",
+    [SelectionClear] = "SelectionClear", [SelectionRequest] = "SelectionRequest",
+    [SelectionNotify] = "SelectionNotify", [ColormapNotify] = "ColormapNotify",
+    [ClientMessage] = "ClientMessage", [MappingNotify] = "MappingNotify",
+    [GenericEvent] = "GenericEvent"
+};
+
+static inline const char *phaseToString(const DiagPhase phase)
+{
+#define X(p) case Phase##p: return TO_STRING(p);
+    switch(phase) {
+        PHASE_TABLE
+    case PhasesCount:
+        break;
+    }
+#undef X
+    return "";
+}
+
+static inline uint64_t clock_ns(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id,&ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* read/write family syscalls counted by the kernel (the read of this file included) */
+static void read_io_syscalls(unsigned long *reads, unsigned long *writes)
+{
+    FILE *f = fopen("/proc/self/io","r");
+    *reads = *writes = 0;
+    if (f) {
+        char line[64];
+        while (fgets(line,sizeof(line),f)) {
+            sscanf(line,"syscr: %lu",reads);
+            sscanf(line,"syscw: %lu",writes);
+        }
+        fclose(f);
+    }
+}
+
+static void snapshot(DiagCounters *counters)
+{
+    struct rusage usage;
+    const LoopStat *stats = NULL;
+    const unsigned int nbStats = loop_stats(&stats);
+    memset(counters->sources,0,sizeof(counters->sources));
+    for (register unsigned int i = 0; i < nbStats; i++) {
+        counters->sources[i] = stats[i].wakeups;
+    }
+    counters->wakeups = loop_wakeups();
+    counters->events = events;
+    counters->requests = NextRequest(diagDisplay);
+    counters->roundTrips = roundTrips;
+    read_io_syscalls(&counters->readSyscalls,&counters->writeSyscalls);
+    getrusage(RUSAGE_SELF,&usage);
+    counters->contextSwitches = usage.ru_nvcsw + usage.ru_nivcsw;
+    counters->cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    counters->wall = clock_ns(CLOCK_MONOTONIC);
+}
+
+/* "X 3, monitor 60" */
+static const char *format_sources(const unsigned long *sources, char *buffer, size_t size)
+{
+    const LoopStat *stats = NULL;
+    const unsigned int nbStats = loop_stats(&stats);
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (register unsigned int i = 0; (i < nbStats) && (length < size); i++) {
+        if (sources[i]) {
+            const int n = snprintf(buffer + length,size - length,"%s%s %lu",(length)?", ":"",stats[i].name,sources[i]);
+            if (n < 0) {
+                break;
+            }
+            length += n;
+        }
+    }
+    return buffer;
+}
+
+static void check_budget(const DiagCounters *delta)
+{
+    /* the last wakeup brought the event which has ended the phase */
+    const unsigned long wakeups = (delta->wakeups > 0)?delta->wakeups - 1:0;
+    if ((budget != WAKEUP_BUDGET_NOT_SET) && (delta->wall > 0)
+            && (wakeups * 60e9 > (double)budget * delta->wall)) {
+        char sources[256];
+        syslog(LOG_WARNING,"wakeup budget exceeded while idle: %lu wakeups in %.3f s (budget %u/min, %lu events, %lu requests; %s)",
+               wakeups,delta->wall / 1e9,budget,delta->events,delta->requests,
+               format_sources(delta->sources,sources,sizeof(sources)));
+    }
+}
+
+void diag_start(Display *display, unsigned int idleBudget)
+{
+    diagDisplay = display;
+    budget = idleBudget;
+    currentPhase = PhaseAcquiring;
+    memset(totals,0,sizeof(totals));
+    memset(eventsByType,0,sizeof(eventsByType));
+    snapshot(&phaseStart);
+}
+
+void diag_phase(DiagPhase phase)
+{
+    if ((diagDisplay) && (phase != currentPhase)) {
+        DiagCounters now;
+        DiagCounters delta;
+        DiagCounters *total = &totals[currentPhase];
+        snapshot(&now);
+        delta.wakeups = now.wakeups - phaseStart.wakeups;
+        delta.events = now.events - phaseStart.events;
+        delta.requests = now.requests - phaseStart.requests;
+        delta.roundTrips = now.roundTrips - phaseStart.roundTrips;
+        delta.readSyscalls = now.readSyscalls - phaseStart.readSyscalls;
+        delta.writeSyscalls = now.writeSyscalls - phaseStart.writeSyscalls;
+        delta.contextSwitches = now.contextSwitches - phaseStart.contextSwitches;
+        delta.cpu = now.cpu - phaseStart.cpu;
+        delta.wall = now.wall - phaseStart.wall;
+        for (register unsigned int i = 0; i < LOOP_MAX_STATS; i++) {
+            delta.sources[i] = now.sources[i] - phaseStart.sources[i];
+            total->sources[i] += delta.sources[i];
+        }
+        if (PhaseIdle == currentPhase) {
+            check_budget(&delta);
+        }
+        total->wakeups += delta.wakeups;
+        total->events += delta.events;
+        total->requests += delta.requests;
+        total->roundTrips += delta.roundTrips;
+        total->readSyscalls += delta.readSyscalls;
+        total->writeSyscalls += delta.writeSyscalls;
+        total->contextSwitches += delta.contextSwitches;
+        total->cpu += delta.cpu;
+        total->wall += delta.wall;
+        phaseStart = now;
+        currentPhase = phase;
+    }
+}
+
+void diag_event(int type)
+{
+    if (diagDisplay) {
+        events++;
+        if ((type >= 0) && (type < LASTEvent)) {
+            eventsByType[type]++;
+        }
+    }
+}
+
+void diag_round_trip(void)
+{
+    roundTrips++;
+}
+
+void diag_report(void)
+{
+    if (diagDisplay) {
+        /* close the current phase */
+        const DiagPhase last = currentPhase;
+        diag_phase((PhaseIdle == last)?PhaseAcquiring:PhaseIdle);
+        for (register int p = 0; p < PhasesCount; p++) {
+            const DiagCounters *total = &totals[p];
+            if (0 == total->wall) {
+                continue;
+            }
+            syslog(LOG_INFO,"phase %s: %.3f s, cpu %.3f ms, %lu wakeups (%.2f/min), %lu events, %lu X requests, %lu round trips, %lu read/%lu write syscalls, %lu context switches",
+                   phaseToString(p),total->wall / 1e9,total->cpu / 1e6,
+                   total->wakeups,total->wakeups * 60e9 / total->wall,
+                   total->events,total->requests,total->roundTrips,
+                   total->readSyscalls,total->writeSyscalls,total->contextSwitches);
+            if (total->wakeups) {
+                char sources[256];
+                syslog(LOG_INFO,"phase %s wakeups by source: %s",phaseToString(p),
+                       format_sources(total->sources,sources,sizeof(sources)));
+            }
+        }
+        for (register int t = 0; t < LASTEvent; t++) {
+            if (eventsByType[t]) {
+                syslog(LOG_INFO,"events %s: %lu",(eventNames[t])?eventNames[t]:"?",eventsByType[t]);
+            }
+        }
+        diagDisplay = NULL;
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ * diag.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef DIAG_H_
+#define DIAG_H_
+
+#include <X11/Xlib.h>
+
+#define WAKEUP_BUDGET_NOT_SET	(unsigned int)(-1)
+
+#define PHASE(p)  X(p)
+#define PHASE_TABLE \
+		PHASE(Acquiring) \
+		PHASE(Idle) \
+		PHASE(EnteringLogin) \
+		PHASE(EnteringPassword) \
+		PHASE(Authenticating)
+
+#define X(p)    Phase##p,
+typedef enum DiagPhase_ {
+    PHASE_TABLE
+    PhasesCount
+} DiagPhase;
+#undef X
+
+/* Wakeup (by event loop source), X traffic, syscall and CPU accounting per
+ * lock phase. idleBudget is the number of wakeups per minute allowed in the
+ * Idle phase, the wakeup which ends it is not counted */
+void diag_start(Display *display, unsigned int idleBudget);
+void diag_phase(DiagPhase phase);
+void diag_event(int type);
+/* after each synchronous X call (reply or XSync) */
+void diag_round_trip(void);
+/* log the summary of all the phases */
+void diag_report(void);
+
+#endif /* DIAG_H_ */
@@ -0,0 +1,297 @@
+/*
+ * hooks.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+
+#include "hooks.h"
+#include "loop.h"
+
+#define NO_DEADLINE     INT64_MAX
+
+#define X(s,n)    n,
+static const char *const stageNames[] = {
+    HOOK_STAGE_TABLE
+};
+#undef X
+
+typedef struct Hook_ {
+    pid_t pid;
+    int pidfd;
+    HookStage stage;
+    HookKillPolicy policy;
+    Bool terminated;        /* SIGTERM sent */
+    Bool left;              /* past its deadline, not waited for */
+    int64_t start;          /* CLOCK_MONOTONIC ms */
+    int64_t deadline;
+    char name[NAME_MAX + 1];
+} Hook;
+
+static Hook hooks[HOOKS_MAX];
+static unsigned int nbHooks = 0;
+static int deadlineTimer = -1;
+
+extern char **environ;
+
+static inline int64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void arm_deadline_timer(void)
+{
+    int64_t next = NO_DEADLINE;
+    for (unsigned int i = 0; i < nbHooks; i++) {
+        if (hooks[i].deadline < next) {
+            next = hooks[i].deadline;
+        }
+    }
+    if (deadlineTimer != -1) {
+        const int64_t delay = next - now_ms();
+        /* 0 would disarm it */
+        loop_arm_timer(deadlineTimer,(NO_DEADLINE == next)?0:((delay > 0)?delay:1),False);
+    }
+}
+
+static void on_deadline(int fd, short revents, void *data)
+{
+    uint64_t expirations;
+    if (read(fd,&expirations,sizeof(expirations)) == -1) {
+        return;
+    }
+    const int64_t now = now_ms();
+    for (unsigned int i = 0; i < nbHooks; i++) {
+        Hook *hook = &hooks[i];
+        if (hook->deadline > now) {
+            continue;
+        }
+        if ((HookKillTerm == hook->policy) && (!hook->terminated)) {
+            syslog(LOG_WARNING,"%s hook %s past its deadline, terminated",stageNames[hook->stage],hook->name);
+            kill(-hook->pid,SIGTERM);
+            hook->terminated = True;
+            hook->deadline = now + HOOK_KILL_GRACE;
+        } else if (HookKillLeave == hook->policy) {
+            syslog(LOG_WARNING,"%s hook %s past its deadline, left running",stageNames[hook->stage],hook->name);
+            hook->deadline = NO_DEADLINE;
+            hook->left = True;
+        } else {
+            syslog(LOG_WARNING,"%s hook %s past its deadline, killed",stageNames[hook->stage],hook->name);
+            kill(-hook->pid,SIGKILL);
+            hook->deadline = NO_DEADLINE;
+        }
+    }
+    arm_deadline_timer();
+}
+
+static void on_hook_exit(int fd, short revents, void *data)
+{
+    for (unsigned int i = 0; i < nbHooks; i++) {
+        Hook *hook = &hooks[i];
+        if (hook->pidfd != fd) {
+            continue;
+        }
+        int status = 0;
+        if (waitpid(hook->pid,&status,WNOHANG) != hook->pid) {
+            return;
+        }
+        const int64_t duration = now_ms() - hook->start;
+        if (WIFEXITED(status)) {
+            syslog((0 == WEXITSTATUS(status))?LOG_INFO:LOG_WARNING,"%s hook %s exited with status %d after %lld ms",
+                   stageNames[hook->stage],hook->name,WEXITSTATUS(status),(long long)duration);
+        } else {
+            syslog(LOG_WARNING,"%s hook %s killed by signal %d after %lld ms",
+                   stageNames[hook->stage],hook->name,WTERMSIG(status),(long long)duration);
+        }
+        loop_remove(fd);
+        close(fd);
+        hooks[i] = hooks[--nbHooks];
+        break;
+    }
+    arm_deadline_timer();
+}
+
+static int spawn_hook(HookStage stage, const char *path, const char *name,
+                      unsigned int timeout, HookKillPolicy policy)
+{
+    int error = EXIT_SUCCESS;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    sigset_t signals;
+    char *const argv[] = { (char *)path, (char *)stageNames[stage], NULL };
+    Hook *hook = &hooks[nbHooks];
+
+    if (nbHooks >= HOOKS_MAX) {
+        syslog(LOG_ERR,"%s hook %s not run, more than %d hooks",stageNames[stage],name,HOOKS_MAX);
+        return ENOSPC;
+    }
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions,STDIN_FILENO,"/dev/null",O_RDONLY,0);
+    posix_spawnattr_init(&attributes);
+    /* own process group to kill the whole script, default signal state */
+    posix_spawnattr_setpgroup(&attributes,0);
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes,&signals);
+    sigfillset(&signals);
+    posix_spawnattr_setsigdefault(&attributes,&signals);
+    /* the hooks run with the real ids, never with the shadow group of a setgid xtrlock */
+    posix_spawnattr_setflags(&attributes,POSIX_SPAWN_SETPGROUP|POSIX_SPAWN_SETSIGMASK|POSIX_SPAWN_SETSIGDEF
+                             |POSIX_SPAWN_RESETIDS);
+
+    const gid_t egid = getegid();
+    if ((egid != getgid()) && (setegid(getgid()) != 0)) {
+        error = errno;
+        syslog(LOG_ERR,"%s hook %s not run, setegid error %d (%m)",stageNames[stage],name,error);
+    } else {
+        hook->start = now_ms();
+        error = posix_spawn(&hook->pid,path,&actions,&attributes,argv,environ);
+        /* back to the saved set-group-ID for the shadow backend */
+        if ((egid != getgid()) && (setegid(egid) != 0)) {
+            syslog(LOG_ERR,"setegid(%d) error %d (%m)",(int)egid,errno);
+        }
+        if (error != EXIT_SUCCESS) {
+            syslog(LOG_ERR,"%s hook %s spawn error %d (%s)",stageNames[stage],name,error,strerror(error));
+        }
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    if (error != EXIT_SUCCESS) {
+        return error;
+    }
+
+    hook->pidfd = syscall(SYS_pidfd_open,hook->pid,0);
+    if ((-1 == hook->pidfd) || (loop_add(hook->pidfd,POLLIN,on_hook_exit,NULL,"hooks") != EXIT_SUCCESS)) {
+        /* it could be neither supervised nor reaped: stopped at once */
+        error = (-1 == hook->pidfd)?errno:ENOSPC;
+        syslog(LOG_ERR,"%s hook %s (pid %d) cannot be supervised (error %d), killed",
+               stageNames[stage],name,hook->pid,error);
+        if (hook->pidfd != -1) {
+            close(hook->pidfd);
+        }
+        kill(-hook->pid,SIGKILL);
+        while ((waitpid(hook->pid,NULL,0) == -1) && (EINTR == errno));
+        return error;
+    }
+    hook->stage = stage;
+    hook->policy = policy;
+    hook->terminated = False;
+    hook->left = False;
+    hook->deadline = hook->start + timeout;
+    snprintf(hook->name,sizeof(hook->name),"%s",name);
+    nbHooks++;
+    return EXIT_SUCCESS;
+}
+
+static int is_hook(const struct dirent *entry)
+{
+    const size_t length = strlen(entry->d_name);
+    return (entry->d_name[0] != '.') && (entry->d_name[length - 1] != '~');
+}
+
+int hooks_run(HookStage stage, const char *path, unsigned int timeout, HookKillPolicy policy)
+{
+    int error = EXIT_SUCCESS;
+    struct stat st;
+    const unsigned int previous = nbHooks;
+
+    if ((NULL == path) || ('\0' == *path)) {
+        return EXIT_SUCCESS;
+    }
+    if (stat(path,&st) != 0) {
+        error = errno;
+        syslog(LOG_ERR,"%s hooks %s error %d (%m)",stageNames[stage],path,error);
+        return error;
+    }
+    if (-1 == deadlineTimer) {
+        deadlineTimer = loop_add_timer(0,False,on_deadline,NULL,"hooks");
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        struct dirent **entries = NULL;
+        const int count = scandir(path,&entries,is_hook,alphasort);
+        if (count < 0) {
+            error = errno;
+            syslog(LOG_ERR,"%s hooks %s error %d (%m)",stageNames[stage],path,error);
+            return error;
+        }
+        for (int i = 0; i < count; i++) {
+            char hookPath[PATH_MAX];
+            snprintf(hookPath,sizeof(hookPath),"%s/%s",path,entries[i]->d_name);
+            if ((stat(hookPath,&st) == 0) && (S_ISREG(st.st_mode)) && (access(hookPath,X_OK) == 0)) {
+                spawn_hook(stage,hookPath,entries[i]->d_name,timeout,policy);
+            }
+            free(entries[i]);
+        }
+        free(entries);
+    } else {
+        const char *name = strrchr(path,'/');
+        error = spawn_hook(stage,path,(name)?name + 1:path,timeout,policy);
+    }
+
+    syslog(LOG_DEBUG,"%u %s hooks started",nbHooks - previous,stageNames[stage]);
+    arm_deadline_timer();
+    return error;
+}
+
+unsigned int hooks_pending(void)
+{
+    unsigned int pending = 0;
+    for (unsigned int i = 0; i < nbHooks; i++) {
+        if (!hooks[i].left) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+void hooks_wait(void)
+{
+    for (;;) {
+        struct pollfd fds[HOOKS_MAX + 1];
+        nfds_t nfds = 0;
+        for (unsigned int i = 0; i < nbHooks; i++) {
+            if (!hooks[i].left) {
+                fds[nfds].fd = hooks[i].pidfd;
+                fds[nfds++].events = POLLIN;
+            }
+        }
+        if ((0 == nfds) || (-1 == deadlineTimer)) {
+            break;
+        }
+        fds[nfds].fd = deadlineTimer;
+        fds[nfds++].events = POLLIN;
+        if ((poll(fds,nfds,-1) == -1) && (errno != EINTR)) {
+            break;
+        }
+        for (nfds_t i = 0; i < nfds; i++) {
+            if (fds[i].revents) {
+                if (fds[i].fd == deadlineTimer) {
+                    on_deadline(fds[i].fd,fds[i].revents,NULL);
+                } else {
+                    on_hook_exit(fds[i].fd,fds[i].revents,NULL);
+                }
+            }
+        }
+    }
+}
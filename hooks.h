@@ -0,0 +1,53 @@
+/*
+ * hooks.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef HOOKS_H_
+#define HOOKS_H_
+
+/*
+ * Hooks: executables run around the lock, the path of one hook or of a
+ * directory whose executable files (not hidden, not ending with ~) are all
+ * run. Each one gets the stage name as argument, /dev/null as input and
+ * its own process group. They all run in parallel; past the deadline the
+ * kill policy applies to the process group. They run with the real user and
+ * group ids, and are only read from a configuration file owned by root and
+ * not writable by group and others.
+ */
+#define HOOK_TIMEOUT            5000    /* ms */
+#define HOOK_KILL_GRACE         1000    /* ms between SIGTERM and SIGKILL */
+#define HOOKS_MAX               32
+
+#define HOOK_STAGE(s,n)  X(s,n)
+#define HOOK_STAGE_TABLE \
+		HOOK_STAGE(PreLock,"pre-lock") \
+		HOOK_STAGE(PostUnlock,"post-unlock")
+
+#define X(s,n)    Hook##s,
+typedef enum HookStage_ {
+    HOOK_STAGE_TABLE
+    HookStagesCount
+} HookStage;
+#undef X
+
+typedef enum HookKillPolicy_ {
+    HookKillTerm,   /* SIGTERM, then SIGKILL after HOOK_KILL_GRACE */
+    HookKillKill,   /* SIGKILL */
+    HookKillLeave   /* log and let it run */
+} HookKillPolicy;
+
+/* spawn the hooks and return, their ends are handled by the event loop */
+int hooks_run(HookStage stage, const char *path, unsigned int timeout, HookKillPolicy policy);
+/* hooks which have a deadline and are still running */
+unsigned int hooks_pending(void);
+/* wait for the hooks which have a deadline, without the event loop */
+void hooks_wait(void);
+
+#endif /* HOOKS_H_ */
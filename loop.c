@@ -0,0 +1,213 @@
+/*
+ * loop.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+
+#include "loop.h"
+
+typedef struct LoopSource_ {
+    int fd;
+    short events;
+    LoopHandler handler;
+    void *data;
+    unsigned int stat;  /* index in stats */
+} LoopSource;
+
+static LoopSource sources[LOOP_MAX_SOURCES];
+static unsigned int nbSources = 0;
+static Bool interrupted = False;
+static unsigned long wakeups = 0;
+/* "X", "signal" and "other" are always there */
+static LoopStat stats[LOOP_MAX_STATS] = { { "X", 0 }, { "signal", 0 }, { "other", 0 } };
+static unsigned int nbStats = 3;
+#define STAT_X      0
+#define STAT_SIGNAL 1
+#define STAT_OTHER  2
+
+static LoopSource *find_source(int fd)
+{
+    for (register unsigned int i = 0; i < nbSources; i++) {
+        if (sources[i].fd == fd) {
+            return &sources[i];
+        }
+    }
+    return NULL;
+}
+
+static unsigned int find_stat(const char *name)
+{
+    if (NULL == name) {
+        return STAT_OTHER;
+    }
+    for (register unsigned int i = 0; i < nbStats; i++) {
+        if (strcmp(stats[i].name,name) == 0) {
+            return i;
+        }
+    }
+    if (nbStats < LOOP_MAX_STATS) {
+        stats[nbStats].name = name;
+        stats[nbStats].wakeups = 0;
+        return nbStats++;
+    }
+    return STAT_OTHER;
+}
+
+int loop_add(int fd, short events, LoopHandler handler, void *data, const char *name)
+{
+    int error = EXIT_SUCCESS;
+    LoopSource *source = find_source(fd);
+    if (source == NULL) {
+        if (nbSources < LOOP_MAX_SOURCES) {
+            source = &sources[nbSources];
+            nbSources++;
+        } else {
+            error = ENOSPC;
+            syslog(LOG_ERR,"too many event sources (limit = %d)",LOOP_MAX_SOURCES);
+        }
+    }
+    if (source) {
+        source->fd = fd;
+        source->events = events;
+        source->handler = handler;
+        source->data = data;
+        source->stat = find_stat(name);
+    }
+    return error;
+}
+
+int loop_remove(int fd)
+{
+    int error = ENOENT;
+    LoopSource *source = find_source(fd);
+    if (source) {
+        nbSources--;
+        *source = sources[nbSources];
+        error = EXIT_SUCCESS;
+    }
+    return error;
+}
+
+int loop_arm_timer(int fd, unsigned int delay_ms, Bool periodic)
+{
+    int error = EXIT_SUCCESS;
+    struct itimerspec spec;
+    memset(&spec,0,sizeof(spec));
+    spec.it_value.tv_sec = delay_ms / 1000;
+    spec.it_value.tv_nsec = (delay_ms % 1000) * 1000000L;
+    if (periodic) {
+        spec.it_interval = spec.it_value;
+    }
+    if (timerfd_settime(fd,0,&spec,NULL) != 0) {
+        error = errno;
+        syslog(LOG_ERR,"timerfd_settime error %d (%m)",error);
+    }
+    return error;
+}
+
+int loop_add_timer(unsigned int period_ms, Bool periodic, LoopHandler handler, void *data, const char *name)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+    if (fd != -1) {
+        if ((loop_arm_timer(fd,period_ms,periodic) != EXIT_SUCCESS)
+                || (loop_add(fd,POLLIN,handler,data,name) != EXIT_SUCCESS)) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        syslog(LOG_ERR,"timerfd_create error %d (%m)",errno);
+    }
+    return fd;
+}
+
+void loop_remove_timer(int fd)
+{
+    if (fd != -1) {
+        loop_remove(fd);
+        close(fd);
+    }
+}
+
+unsigned long loop_wakeups(void)
+{
+    return wakeups;
+}
+
+unsigned int loop_stats(const LoopStat **loopStats)
+{
+    *loopStats = stats;
+    return nbStats;
+}
+
+void loop_interrupt(void)
+{
+    interrupted = True;
+}
+
+int loop_next_event(Display *display, XEvent *event)
+{
+    struct pollfd fds[LOOP_MAX_SOURCES + 1];
+
+    if (interrupted) {
+        interrupted = False;
+        return EINTR;
+    }
+
+    /* XPending() flushes the output buffer and reads what is already available */
+    while (!XPending(display)) {
+        const unsigned int n = nbSources;
+        fds[0].fd = ConnectionNumber(display);
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        for (register unsigned int i = 0; i < n; i++) {
+            fds[i + 1].fd = sources[i].fd;
+            fds[i + 1].events = sources[i].events;
+            fds[i + 1].revents = 0;
+        }
+
+        const int ready = poll(fds,n + 1,-1);
+        wakeups++;
+        if (ready < 0) {
+            if (errno != EINTR) {
+                const int error = errno;
+                syslog(LOG_ERR,"poll error %d (%m)",error);
+                return error;
+            }
+            stats[STAT_SIGNAL].wakeups++;
+            continue;
+        }
+        if (fds[0].revents) {
+            stats[STAT_X].wakeups++;
+        }
+
+        /* handlers may add or remove sources: look them up again by fd */
+        for (register unsigned int i = 1; i <= n; i++) {
+            if (fds[i].revents) {
+                LoopSource *source = find_source(fds[i].fd);
+                if (source) {
+                    stats[source->stat].wakeups++;
+                    source->handler(fds[i].fd,fds[i].revents,source->data);
+                }
+            }
+        }
+        if (interrupted) {
+            interrupted = False;
+            return EINTR;
+        }
+        if (fds[0].revents & (POLLERR|POLLHUP)) {
+            /* let Xlib report the broken connection */
+            break;
+        }
+    }
+    XNextEvent(display,event);
+    return EXIT_SUCCESS;
+}
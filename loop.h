@@ -0,0 +1,51 @@
+/*
+ * loop.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef LOOP_H_
+#define LOOP_H_
+
+#include <X11/Xlib.h>
+
+/* Maximum number of file descriptors watched besides the X connection */
+#define LOOP_MAX_SOURCES 96
+/* Maximum number of source names counted apart, the others are counted as "other" */
+#define LOOP_MAX_STATS 24
+
+typedef void (*LoopHandler)(int fd, short revents, void *data);
+
+/* Watch fd for the poll(2) events, handler is called from loop_next_event().
+ * name (static storage) attributes the wakeups, sources may share a name */
+int loop_add(int fd, short events, LoopHandler handler, void *data, const char *name);
+int loop_remove(int fd);
+
+/* Create a CLOCK_MONOTONIC timerfd firing every period_ms (one shot if periodic is False) */
+int loop_add_timer(unsigned int period_ms, Bool periodic, LoopHandler handler, void *data, const char *name);
+int loop_arm_timer(int fd, unsigned int delay_ms, Bool periodic);
+void loop_remove_timer(int fd);
+
+/* Like XNextEvent() but dispatch the other sources while waiting,
+ * return EINTR without event if a handler has called loop_interrupt() */
+int loop_next_event(Display *display, XEvent *event);
+void loop_interrupt(void);
+
+/* Number of returns from poll(2) since the start */
+unsigned long loop_wakeups(void);
+
+/* Wakeups by source name since the start: a return from poll(2) counts for
+ * each ready source, "X" is the X connection and "signal" an interrupted poll.
+ * The entries are never removed, their index is stable */
+typedef struct LoopStat_ {
+    const char *name;
+    unsigned long wakeups;
+} LoopStat;
+unsigned int loop_stats(const LoopStat **stats);
+
+#endif /* LOOP_H_ */
@@ -0,0 +1,131 @@
+/*
+ * mkcredcache.c
+ *
+ * Write the offline credential cache of xtrlock from the shadow entries of
+ * the given logins: xtrlock-mkcache [-o file] login...
+ * To be run by root out of band (cron, systemd timer...).
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <shadow.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "credcache.h"
+
+static int compare_entries(const void *a, const void *b)
+{
+    return strncmp(((const CredCacheEntry *)a)->login,((const CredCacheEntry *)b)->login,CREDCACHE_LOGIN_SIZE);
+}
+
+static int write_cache(const char *path, CredCacheEntry *entries, uint32_t count)
+{
+    int error = EXIT_SUCCESS;
+    CredCacheHeader header;
+    char tmp[4096];
+    struct stat shadowStat;
+
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,CREDCACHE_MAGIC,sizeof(header.magic));
+    header.version = CREDCACHE_VERSION;
+    header.count = count;
+    header.generated = time(NULL);
+
+    snprintf(tmp,sizeof(tmp),"%s.XXXXXX",path);
+    const int fd = mkstemp(tmp);
+    if (-1 == fd) {
+        error = errno;
+        fprintf(stderr,"cannot create %s: %s\n",tmp,strerror(error));
+        return error;
+    }
+    /* readable like /etc/shadow */
+    if (stat("/etc/shadow",&shadowStat) == 0) {
+        if (fchown(fd,0,shadowStat.st_gid) != 0) {
+            error = errno;
+        }
+    }
+    if ((EXIT_SUCCESS == error) && (fchmod(fd,S_IRUSR|S_IWUSR|S_IRGRP) != 0)) {
+        error = errno;
+    }
+    if ((EXIT_SUCCESS == error)
+            && ((write(fd,&header,sizeof(header)) != sizeof(header))
+                || (write(fd,entries,count * sizeof(CredCacheEntry)) != (ssize_t)(count * sizeof(CredCacheEntry))))) {
+        error = (errno)?errno:EIO;
+    }
+    if ((EXIT_SUCCESS == error) && (fsync(fd) != 0)) {
+        error = errno;
+    }
+    close(fd);
+
+    if ((EXIT_SUCCESS == error) && (rename(tmp,path) != 0)) {
+        error = errno;
+    }
+    if (error != EXIT_SUCCESS) {
+        fprintf(stderr,"cannot write %s: %s\n",path,strerror(error));
+        unlink(tmp);
+    }
+    return error;
+}
+
+int main(int argc, char *argv[])
+{
+    int error = EXIT_SUCCESS;
+    const char *path = CREDCACHE_DEFAULT_PATH;
+    int opt;
+
+    while ((opt = getopt(argc,argv,"o:h")) != -1) {
+        switch (opt) {
+        case 'o':
+            path = optarg;
+            break;
+        default:
+            fprintf(stderr,"Usage: xtrlock-mkcache [-o file] login..." "\n"
+                    "With credential-cache-mode = first, a password found in the cache unlocks" "\n"
+                    "without the PAM authentication modules: the other factors (OTP...) of the" "\n"
+                    "PAM stack are skipped, only its account checks still run." "\n");
+            return (opt == 'h')?EXIT_SUCCESS:EINVAL;
+        }
+    }
+
+    CredCacheEntry *entries = calloc((argc > optind)?argc - optind:1,sizeof(CredCacheEntry));
+    if (NULL == entries) {
+        return ENOMEM;
+    }
+
+    uint32_t count = 0;
+    for (int i = optind; i < argc; i++) {
+        const struct spwd *sp = getspnam(argv[i]);
+        if (NULL == sp) {
+            fprintf(stderr,"%s: no shadow entry, skipped\n",argv[i]);
+        } else if (('!' == sp->sp_pwdp[0]) || ('*' == sp->sp_pwdp[0]) || ('\0' == sp->sp_pwdp[0])) {
+            fprintf(stderr,"%s: locked or empty password, skipped\n",argv[i]);
+        } else if ((strlen(argv[i]) >= CREDCACHE_LOGIN_SIZE) || (strlen(sp->sp_pwdp) >= CREDCACHE_HASH_SIZE)) {
+            fprintf(stderr,"%s: login or hash too long, skipped\n",argv[i]);
+        } else {
+            strcpy(entries[count].login,argv[i]);
+            strcpy(entries[count].hash,sp->sp_pwdp);
+            count++;
+        }
+    }
+
+    qsort(entries,count,sizeof(CredCacheEntry),compare_entries);
+    for (uint32_t i = 1; i < count; i++) {
+        if (compare_entries(&entries[i - 1],&entries[i]) == 0) {
+            memmove(&entries[i - 1],&entries[i],(count - i) * sizeof(CredCacheEntry));
+            count--;
+            i--;
+        }
+    }
+
+    error = write_cache(path,entries,count);
+    explicit_bzero(entries,count * sizeof(CredCacheEntry));
+    free(entries);
+    return error;
+}
@@ -0,0 +1,155 @@
+/*
+ * monitor.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "loop.h"
+#include "monitor.h"
+
+static MonitorPage *page = NULL;
+static char pageName[64];
+static int heartbeatTimer = -1;
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void write_begin(void)
+{
+    __atomic_store_n(&page->sequence,page->sequence + 1,__ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void write_end(void)
+{
+    __atomic_store_n(&page->sequence,page->sequence + 1,__ATOMIC_RELEASE);
+}
+
+static void on_heartbeat_timer(int fd, short revents, void *data)
+{
+    uint64_t expirations;
+    if (read(fd,&expirations,sizeof(expirations)) == sizeof(expirations)) {
+        monitor_heartbeat();
+    }
+}
+
+int monitor_open(void)
+{
+    int error = EXIT_SUCCESS;
+    snprintf(pageName,sizeof(pageName),MONITOR_NAME_FORMAT,getuid(),getpid());
+    /* the user's agents only: the event times must not reach the other users */
+    const int fd = shm_open(pageName,O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC,S_IRUSR|S_IWUSR);
+    if (fd != -1) {
+        if (ftruncate(fd,sizeof(MonitorPage)) == 0) {
+            void *p = mmap(NULL,sizeof(MonitorPage),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+            if (p != MAP_FAILED) {
+                page = (MonitorPage *)p;
+                write_begin();
+                page->magic = MONITOR_MAGIC;
+                page->version = MONITOR_VERSION;
+                page->pid = getpid();
+                page->uid = getuid();
+                page->lastHeartbeat = page->lastEvent = now_ns();
+                write_end();
+            } else {
+                error = errno;
+                syslog(LOG_ERR,"mmap %s error %d (%m)",pageName,error);
+            }
+        } else {
+            error = errno;
+            syslog(LOG_ERR,"ftruncate %s error %d (%m)",pageName,error);
+        }
+        close(fd);
+        if (error != EXIT_SUCCESS) {
+            shm_unlink(pageName);
+        }
+    } else {
+        error = errno;
+        syslog(LOG_ERR,"shm_open %s error %d (%m)",pageName,error);
+    }
+
+    if (EXIT_SUCCESS == error) {
+        heartbeatTimer = loop_add_timer(MONITOR_HEARTBEAT_MS,True,on_heartbeat_timer,NULL,"monitor");
+        syslog(LOG_DEBUG,"monitoring page %s published",pageName);
+    }
+    return error;
+}
+
+void monitor_close(void)
+{
+    if (page) {
+        loop_remove_timer(heartbeatTimer);
+        heartbeatTimer = -1;
+        munmap(page,sizeof(MonitorPage));
+        page = NULL;
+        shm_unlink(pageName);
+    }
+}
+
+void monitor_heartbeat(void)
+{
+    if (page) {
+        write_begin();
+        page->heartbeat++;
+        page->lastHeartbeat = now_ns();
+        write_end();
+    }
+}
+
+void monitor_event(void)
+{
+    if (page) {
+        /* rounded down to the second: no keystroke timing */
+        const uint64_t second = now_ns() / 1000000000ULL * 1000000000ULL;
+        if (second != page->lastEvent) {
+            write_begin();
+            page->lastEvent = second;
+            write_end();
+        }
+    }
+}
+
+void monitor_set_state(unsigned int state, const char *name)
+{
+    if (page) {
+        write_begin();
+        page->state = state;
+        strncpy(page->stateName,name,sizeof(page->stateName) - 1);
+        write_end();
+    }
+}
+
+void monitor_set_grabs(int held)
+{
+    if (page) {
+        write_begin();
+        page->grabsHeld = held;
+        write_end();
+    }
+}
+
+void monitor_set_auth(int inProgress)
+{
+    if (page) {
+        write_begin();
+        page->authInProgress = inProgress;
+        page->authStarted = (inProgress)?now_ns():0;
+        write_end();
+    }
+}
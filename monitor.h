@@ -0,0 +1,55 @@
+/*
+ * monitor.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef MONITOR_H_
+#define MONITOR_H_
+
+#include <stdint.h>
+
+/*
+ * Read-only shared memory page published in /dev/shm/xtrlock.<uid>.<pid>
+ * (mode 0600) for the monitoring agents of the user.
+ * The page is updated with a seqlock: a reader copies it while sequence is
+ * even and unchanged before and after the copy, else it retries.
+ * Timestamps are CLOCK_MONOTONIC nanoseconds.
+ */
+#define MONITOR_MAGIC           0x4b4c5458 /* "XTLK" */
+#define MONITOR_VERSION         1
+#define MONITOR_NAME_FORMAT     "/xtrlock.%u.%d"
+#define MONITOR_HEARTBEAT_MS    1000
+
+typedef struct MonitorPage_ {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sequence;          /* odd while an update is in progress */
+    int32_t pid;
+    uint32_t uid;
+    uint32_t state;             /* State enum value of xtrlock.c */
+    char stateName[16];
+    uint64_t heartbeat;         /* advanced every MONITOR_HEARTBEAT_MS by the event loop */
+    uint64_t lastHeartbeat;
+    uint64_t lastEvent;         /* last X event received while idle, to the second */
+    uint64_t authStarted;       /* start of the pending authentication */
+    uint32_t grabsHeld;
+    uint32_t authInProgress;
+} MonitorPage;
+
+int monitor_open(void);
+void monitor_close(void);
+
+void monitor_heartbeat(void);
+/* not called while a login, password or answer is typed */
+void monitor_event(void);
+void monitor_set_state(unsigned int state, const char *name);
+void monitor_set_grabs(int held);
+void monitor_set_auth(int inProgress);
+
+#endif /* MONITOR_H_ */
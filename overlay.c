@@ -0,0 +1,227 @@
+/*
+ * overlay.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <X11/Xlib.h>
+
+#include "diag.h"
+#include "loop.h"
+#include "overlay.h"
+
+#define FIRST_GLYPH     ' '
+#define LAST_GLYPH      '~'
+#define GLYPHS_COUNT    (LAST_GLYPH - FIRST_GLYPH + 1)
+
+/* one blank cell around the text */
+#define LINES_COUNT     6
+#define GRID_COLUMNS    (OVERLAY_COLUMNS + 2)
+#define GRID_ROWS       (LINES_COUNT + 2)
+
+#define OWNER_PREFIX    "Session of "
+
+static Display *overlayDisplay = NULL;
+static Window overlayWindow = None;
+static Pixmap atlas = None;
+static GC gc = None;
+static int cellWidth, cellHeight;
+static int originX, originY;
+static int minuteTimer = -1;
+
+static char owner[OVERLAY_COLUMNS - sizeof(OWNER_PREFIX) + 2];
+static time_t lockTime;
+static unsigned int failedAttempts = 0;
+static char notice[OVERLAY_COLUMNS + 1];
+static char prompt[OVERLAY_COLUMNS + 1];
+
+/* cells as they are on the screen, 0 when unknown */
+static char shown[GRID_ROWS][GRID_COLUMNS];
+
+static inline char printable(char c)
+{
+    return ((c >= FIRST_GLYPH) && (c <= LAST_GLYPH))?c:'?';
+}
+
+static void format_lines(char lines[GRID_ROWS][GRID_COLUMNS])
+{
+    char text[LINES_COUNT][OVERLAY_COLUMNS + 1];
+    struct tm tm;
+    const time_t now = time(NULL);
+    /* in whole minutes of the wall clock, as the lock time is displayed */
+    const long elapsed = (now >= lockTime)?(now / 60 - lockTime / 60):0;
+
+    snprintf(text[0],sizeof(text[0]),OWNER_PREFIX "%s",owner);
+    localtime_r(&lockTime,&tm);
+    strftime(text[1],sizeof(text[1]),"Locked since %Y-%m-%d %H:%M",&tm);
+    if (elapsed >= 24 * 60) {
+        snprintf(text[2],sizeof(text[2]),"Locked for %ldd %02ldh %02ldmin",
+                 elapsed / (24 * 60),(elapsed / 60) % 24,elapsed % 60);
+    } else {
+        snprintf(text[2],sizeof(text[2]),"Locked for %ldh %02ldmin",elapsed / 60,elapsed % 60);
+    }
+    snprintf(text[3],sizeof(text[3]),"%u failed attempt%s",failedAttempts,(failedAttempts != 1)?"s":"");
+    memcpy(text[4],notice,sizeof(notice));
+    memcpy(text[5],prompt,sizeof(prompt));
+
+    memset(lines,' ',GRID_ROWS * GRID_COLUMNS);
+    for (int l = 0; l < LINES_COUNT; l++) {
+        for (int c = 0; text[l][c] != '\0'; c++) {
+            lines[l + 1][c + 1] = printable(text[l][c]);
+        }
+    }
+}
+
+static void draw(void)
+{
+    char lines[GRID_ROWS][GRID_COLUMNS];
+    unsigned int copies = 0;
+
+    format_lines(lines);
+    for (int r = 0; r < GRID_ROWS; r++) {
+        for (int c = 0; c < GRID_COLUMNS; c++) {
+            if (lines[r][c] != shown[r][c]) {
+                XCopyArea(overlayDisplay,atlas,overlayWindow,gc,
+                          (lines[r][c] - FIRST_GLYPH) * cellWidth,0,cellWidth,cellHeight,
+                          originX + c * cellWidth,originY + r * cellHeight);
+                shown[r][c] = lines[r][c];
+                copies++;
+            }
+        }
+    }
+    if (copies) {
+        XFlush(overlayDisplay);
+    }
+}
+
+static int arm_minute_timer(int fd)
+{
+    int error = EXIT_SUCCESS;
+    struct itimerspec spec;
+    memset(&spec,0,sizeof(spec));
+    /* next minute boundary of the wall clock, then every minute */
+    spec.it_value.tv_sec = (time(NULL) / 60 + 1) * 60;
+    spec.it_interval.tv_sec = 60;
+    if (timerfd_settime(fd,TFD_TIMER_ABSTIME|TFD_TIMER_CANCEL_ON_SET,&spec,NULL) != 0) {
+        error = errno;
+        syslog(LOG_ERR,"timerfd_settime error %d (%m)",error);
+    }
+    return error;
+}
+
+static void on_minute_timer(int fd, short revents, void *data)
+{
+    uint64_t expirations;
+    if ((read(fd,&expirations,sizeof(expirations)) == -1) && (ECANCELED == errno)) {
+        /* the wall clock has been set, realign on its minutes */
+        arm_minute_timer(fd);
+    }
+    draw();
+}
+
+int overlay_create(Display *display, Window window, int screen, const char *sessionOwner)
+{
+    int error = EXIT_SUCCESS;
+    XFontStruct *font = XLoadQueryFont(display,OVERLAY_FONT);
+    diag_round_trip();
+    if (NULL == font) {
+        font = XLoadQueryFont(display,OVERLAY_FALLBACK_FONT);
+        diag_round_trip();
+    }
+    if (NULL == font) {
+        syslog(LOG_ERR,"cannot load the overlay fonts %s and %s",OVERLAY_FONT,OVERLAY_FALLBACK_FONT);
+        return ENOENT;
+    }
+
+    overlayDisplay = display;
+    overlayWindow = window;
+    cellWidth = font->max_bounds.width;
+    cellHeight = font->ascent + font->descent;
+    originX = (DisplayWidth(display,screen) - GRID_COLUMNS * cellWidth) / 2;
+    originY = (DisplayHeight(display,screen) - GRID_ROWS * cellHeight) / 2;
+
+    /* glyphs side by side, white on black, in the depth of the window */
+    atlas = XCreatePixmap(display,window,GLYPHS_COUNT * cellWidth,cellHeight,DefaultDepth(display,screen));
+    XGCValues values;
+    values.foreground = WhitePixel(display,screen);
+    values.background = BlackPixel(display,screen);
+    values.font = font->fid;
+    /* no NoExpose event for each copy */
+    values.graphics_exposures = False;
+    gc = XCreateGC(display,window,GCForeground|GCBackground|GCFont|GCGraphicsExposures,&values);
+    for (int g = 0; g < GLYPHS_COUNT; g++) {
+        const char glyph = FIRST_GLYPH + g;
+        XDrawImageString(display,atlas,gc,g * cellWidth,font->ascent,&glyph,1);
+    }
+    XFreeFont(display,font);
+
+    snprintf(owner,sizeof(owner),"%s",(sessionOwner)?sessionOwner:"???");
+    memset(shown,0,sizeof(shown));
+    syslog(LOG_DEBUG,"overlay atlas of %d glyphs %dx%d",GLYPHS_COUNT,cellWidth,cellHeight);
+    return error;
+}
+
+void overlay_start(time_t lockedAt)
+{
+    if (None == atlas) {
+        return;
+    }
+    lockTime = lockedAt;
+    minuteTimer = timerfd_create(CLOCK_REALTIME,TFD_NONBLOCK|TFD_CLOEXEC);
+    if (minuteTimer != -1) {
+        if ((arm_minute_timer(minuteTimer) != EXIT_SUCCESS)
+                || (loop_add(minuteTimer,POLLIN,on_minute_timer,NULL,"overlay") != EXIT_SUCCESS)) {
+            close(minuteTimer);
+            minuteTimer = -1;
+        }
+    } else {
+        syslog(LOG_ERR,"timerfd_create error %d (%m)",errno);
+    }
+    draw();
+}
+
+void overlay_failed_attempt(void)
+{
+    failedAttempts++;
+    if (atlas != None) {
+        draw();
+    }
+}
+
+void overlay_prompt(const char *message, const char *question)
+{
+    snprintf(notice,sizeof(notice),"%s",(message)?message:"");
+    snprintf(prompt,sizeof(prompt),"%s",(question)?question:"");
+    if (atlas != None) {
+        draw();
+    }
+}
+
+void overlay_expose(void)
+{
+    if (atlas != None) {
+        /* the server has painted the background over the panel */
+        memset(shown,0,sizeof(shown));
+        draw();
+    }
+}
+
+void overlay_destroy(void)
+{
+    if (atlas != None) {
+        loop_remove_timer(minuteTimer);
+        minuteTimer = -1;
+        XFreeGC(overlayDisplay,gc);
+        XFreePixmap(overlayDisplay,atlas);
+        atlas = None;
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * overlay.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef OVERLAY_H_
+#define OVERLAY_H_
+
+#include <time.h>
+#include <X11/Xlib.h>
+
+/* core fonts tried in turn, the glyphs are laid out on a fixed grid */
+#define OVERLAY_FONT            "9x15"
+#define OVERLAY_FALLBACK_FONT   "fixed"
+#define OVERLAY_COLUMNS         40
+
+/*
+ * Status panel drawn on the lock window: session owner, lock time, elapsed
+ * time, failed attempts and the pending question of the authentication
+ * backend with its last message. The printable ASCII glyphs are rasterized
+ * once in a pixmap of the server, a redraw copies the cells which have
+ * changed.
+ * It is refreshed at each minute of the wall clock and on failed attempts.
+ */
+int overlay_create(Display *display, Window window, int screen, const char *owner);
+void overlay_start(time_t lockedAt);
+void overlay_failed_attempt(void);
+/* NULL or "" clears the line */
+void overlay_prompt(const char *message, const char *question);
+void overlay_expose(void);
+void overlay_destroy(void);
+
+#endif /* OVERLAY_H_ */
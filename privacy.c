@@ -0,0 +1,126 @@
+/*
+ * privacy.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdlib.h>
+#include <syslog.h>
+#include <time.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#include "blur.h"
+#include "diag.h"
+#include "privacy.h"
+
+static int shmError = 0;
+
+static int on_shm_error(Display *display, XErrorEvent *event)
+{
+    shmError = event->error_code;
+    return 0;
+}
+
+static XImage *capture_shm(Display *display, int screen, XShmSegmentInfo *shminfo)
+{
+    const unsigned int width = DisplayWidth(display,screen);
+    const unsigned int height = DisplayHeight(display,screen);
+    XImage *image = XShmCreateImage(display,DefaultVisual(display,screen),DefaultDepth(display,screen),
+                                    ZPixmap,NULL,shminfo,width,height);
+    if (NULL == image) {
+        return NULL;
+    }
+    shminfo->shmid = shmget(IPC_PRIVATE,image->bytes_per_line * image->height,IPC_CREAT|0600);
+    if (shminfo->shmid != -1) {
+        shminfo->shmaddr = image->data = shmat(shminfo->shmid,NULL,0);
+        /* destroyed once both sides have detached */
+        shmctl(shminfo->shmid,IPC_RMID,NULL);
+        if (shminfo->shmaddr != (char *)-1) {
+            shminfo->readOnly = False;
+            /* a remote server fails the attach asynchronously */
+            XErrorHandler previous = XSetErrorHandler(on_shm_error);
+            shmError = 0;
+            XShmAttach(display,shminfo);
+            XSync(display,False);
+            diag_round_trip();
+            if (0 == shmError) {
+                const Status captured = XShmGetImage(display,RootWindow(display,screen),image,0,0,AllPlanes);
+                diag_round_trip();
+                if (captured) {
+                    XSetErrorHandler(previous);
+                    return image;
+                }
+            }
+            XSetErrorHandler(previous);
+            if (0 == shmError) {
+                XShmDetach(display,shminfo);
+            }
+            shmdt(shminfo->shmaddr);
+        }
+    }
+    image->data = NULL;
+    XDestroyImage(image);
+    return NULL;
+}
+
+Pixmap privacy_background(Display *display, int screen)
+{
+    struct timespec start, end;
+    XShmSegmentInfo shminfo;
+    Bool shm = False;
+    XImage *image = NULL;
+    Pixmap pixmap = None;
+    const char *kernelName = NULL;
+    const PixelateKernel kernel = blur_kernel(&kernelName);
+
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    const Bool hasShm = XShmQueryExtension(display);
+    diag_round_trip();
+    if (hasShm) {
+        image = capture_shm(display,screen,&shminfo);
+        shm = (image != NULL);
+    }
+    if (NULL == image) {
+        image = XGetImage(display,RootWindow(display,screen),0,0,
+                          DisplayWidth(display,screen),DisplayHeight(display,screen),AllPlanes,ZPixmap);
+        diag_round_trip();
+    }
+    if (NULL == image) {
+        syslog(LOG_ERR,"cannot capture the screen");
+        return None;
+    }
+
+    if (32 == image->bits_per_pixel) {
+        kernel((uint8_t *)image->data,image->width,image->height,image->bytes_per_line,BLUR_BLOCK);
+        pixmap = XCreatePixmap(display,RootWindow(display,screen),image->width,image->height,image->depth);
+        GC gc = XCreateGC(display,pixmap,0,NULL);
+        if (shm) {
+            XShmPutImage(display,pixmap,gc,image,0,0,0,0,image->width,image->height,False);
+        } else {
+            XPutImage(display,pixmap,gc,image,0,0,0,0,image->width,image->height);
+        }
+        XFreeGC(display,gc);
+    } else {
+        syslog(LOG_ERR,"privacy mode needs a 32 bits per pixel screen (%d)",image->bits_per_pixel);
+    }
+
+    if (shm) {
+        /* the server must be done with the segment */
+        XSync(display,False);
+        diag_round_trip();
+        XShmDetach(display,&shminfo);
+        shmdt(shminfo.shmaddr);
+        image->data = NULL;
+    }
+    XDestroyImage(image);
+
+    clock_gettime(CLOCK_MONOTONIC,&end);
+    syslog(LOG_NOTICE,"privacy background %dx%d (%s, %s) in %.3f ms",
+           DisplayWidth(display,screen),DisplayHeight(display,screen),(shm)?"MIT-SHM":"XGetImage",kernelName,
+           (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+    return pixmap;
+}
@@ -0,0 +1,21 @@
+/*
+ * privacy.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef PRIVACY_H_
+#define PRIVACY_H_
+
+#include <X11/Xlib.h>
+
+/* Capture the root window (MIT-SHM when available), pixelate it and return
+ * it in a pixmap for the background of the lock window, None on failure */
+Pixmap privacy_background(Display *display, int screen);
+
+#endif /* PRIVACY_H_ */
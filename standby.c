@@ -0,0 +1,135 @@
+/*
+ * standby.c
+ *
+ *  Created on: 19 oct. 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "loop.h"
+#include "standby.h"
+
+static int primarySocket = -1;
+static pid_t standbyPid = -1;
+
+static void on_standby_hangup(int fd, short revents, void *data)
+{
+    StandbyMessage message;
+    if ((revents & (POLLHUP|POLLERR)) || (read(fd,&message,sizeof(message)) <= 0)) {
+        int status = 0;
+        waitpid(standbyPid,&status,WNOHANG);
+        syslog(LOG_ERR,"standby locker %d has ended (status 0x%x): no more takeover",standbyPid,status);
+        loop_remove(fd);
+        close(fd);
+        primarySocket = -1;
+        standbyPid = -1;
+    }
+}
+
+int standby_spawn(char *const argv[])
+{
+    int error = EXIT_SUCCESS;
+    int sockets[2];
+    if (socketpair(AF_UNIX,SOCK_SEQPACKET|SOCK_CLOEXEC,0,sockets) == 0) {
+        const pid_t pid = fork();
+        if (0 == pid) {
+            char fd[16];
+            /* only the standby end survives the exec */
+            fcntl(sockets[1],F_SETFD,0);
+            snprintf(fd,sizeof(fd),"%d",sockets[1]);
+            setenv(STANDBY_FD_ENV,fd,1);
+            execv("/proc/self/exe",argv);
+            syslog(LOG_ERR,"standby exec error %d (%m)",errno);
+            _exit(EXIT_FAILURE);
+        } else if (pid > 0) {
+            close(sockets[1]);
+            primarySocket = sockets[0];
+            standbyPid = pid;
+            loop_add(primarySocket,POLLIN,on_standby_hangup,NULL,"standby");
+            syslog(LOG_NOTICE,"standby locker %d started",pid);
+        } else {
+            error = errno;
+            syslog(LOG_ERR,"standby fork error %d (%m)",error);
+            close(sockets[0]);
+            close(sockets[1]);
+        }
+    } else {
+        error = errno;
+        syslog(LOG_ERR,"standby socketpair error %d (%m)",error);
+    }
+    return error;
+}
+
+void standby_backoff(const StandbyBackoff *backoff)
+{
+    if (primarySocket != -1) {
+        StandbyMessage message;
+        memset(&message,0,sizeof(message));
+        message.type = STANDBY_BACKOFF;
+        message.backoff = *backoff;
+        if (send(primarySocket,&message,sizeof(message),MSG_NOSIGNAL|MSG_DONTWAIT) != sizeof(message)) {
+            syslog(LOG_ERR,"standby backoff error %d (%m)",errno);
+        }
+    }
+}
+
+void standby_release(void)
+{
+    if (primarySocket != -1) {
+        const char goodbye = STANDBY_GOODBYE;
+        if (send(primarySocket,&goodbye,sizeof(goodbye),MSG_NOSIGNAL) != sizeof(goodbye)) {
+            syslog(LOG_ERR,"standby goodbye error %d (%m)",errno);
+        }
+        loop_remove(primarySocket);
+        close(primarySocket);
+        primarySocket = -1;
+    }
+}
+
+int standby_role(void)
+{
+    int fd = -1;
+    const char *value = getenv(STANDBY_FD_ENV);
+    if (value) {
+        char *end = NULL;
+        fd = strtol(value,&end,10);
+        if ((end == value) || (*end != '\0') || (fcntl(fd,F_SETFD,FD_CLOEXEC) != 0)) {
+            syslog(LOG_ERR,"invalid " STANDBY_FD_ENV " %s",value);
+            fd = -1;
+        }
+        unsetenv(STANDBY_FD_ENV);
+    }
+    return fd;
+}
+
+int standby_wait(int fd, StandbyBackoff *backoff)
+{
+    int error = EXIT_SUCCESS;
+    StandbyMessage message;
+    ssize_t n;
+
+    /* one message per datagram, the end of file is the death of the primary */
+    while (((n = recv(fd,&message,sizeof(message),0)) > 0) || ((n < 0) && (EINTR == errno))) {
+        if (n <= 0) {
+            continue;
+        }
+        if (STANDBY_GOODBYE == message.type) {
+            error = ECANCELED;
+            break;
+        }
+        if ((STANDBY_BACKOFF == message.type) && (sizeof(message) == n)) {
+            *backoff = message.backoff;
+        }
+    }
+    close(fd);
+    return error;
+}
@@ -0,0 +1,49 @@
+/*
+ * standby.h
+ *
+ *  Created on: 19 oct. 2026
+ */
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+
+#if (GCC_VERSION > 40000) /* GCC 4.0.0 */
+#pragma once
+#endif /* GCC 4.0.0 */
+
+#ifndef STANDBY_H_
+#define STANDBY_H_
+
+/*
+ * Hot standby: once the grabs are held, the primary starts a copy of itself
+ * which opens its own display connection, builds its window and cursors and
+ * waits on a socket shared with the primary. The primary says goodbye on a
+ * normal exit, a hang up without goodbye means it has died: the standby maps
+ * its window and grabs the input in its place. The primary also sends its
+ * backoff state after each failed attempt, the standby resumes from the
+ * last one.
+ */
+#define STANDBY_FD_ENV  "XTRLOCK_STANDBY_FD"
+#define STANDBY_GOODBYE 'U'
+#define STANDBY_BACKOFF 'B'
+
+typedef struct StandbyBackoff_ {
+    long goodwill;
+    long timeout;   /* X server time before which the keys are refused */
+} StandbyBackoff;
+
+typedef struct StandbyMessage_ {
+    char type;
+    StandbyBackoff backoff; /* STANDBY_BACKOFF */
+} StandbyMessage;
+
+/* primary side */
+int standby_spawn(char *const argv[]);
+void standby_backoff(const StandbyBackoff *backoff);
+void standby_release(void);
+
+/* standby side: socket inherited from the primary or -1 */
+int standby_role(void);
+/* block until the primary ends, return ECANCELED if it has unlocked the session,
+ * backoff is updated with the last state sent by the primary */
+int standby_wait(int fd, StandbyBackoff *backoff);
+
+#endif /* STANDBY_H_ */
@@ -39,6 +39,8 @@
 #include <ctype.h>
 #include <values.h>
 #include <syslog.h>
+#include <poll.h>
+#include <time.h>
 
 #ifdef SHADOW_PWD
 #include <shadow.h>
@@ -50,7 +52,17 @@
 #endif
 
 #include "auth.h"
+#include "bus.h"
 #include "cmdline_parameters.h"
+#include "completion.h"
+#include "config.h"
+#include "diag.h"
+#include "hooks.h"
+#include "loop.h"
+#include "monitor.h"
+#include "overlay.h"
+#include "privacy.h"
+#include "standby.h"
 #include "patchlevel.h"
 #include "lock.bitmap"
 #include "mask.bitmap"
@@ -68,7 +80,10 @@
 #define STATE_TABLE \
 		STATE(Idle,lock) \
 		STATE(LoginName,user) \
-		STATE(Password,password)
+		STATE(Password,password) \
+		STATE(Authenticating,lock) \
+		STATE(PromptEchoOn,user) \
+		STATE(PromptEchoOff,password)
 
 #define X(s,b)    s,
 typedef enum State_ {
@@ -93,6 +108,11 @@ State nextState(const State state)
         next = Password;
         break;
     case Password:
+        next = Authenticating;
+        break;
+    case Authenticating:
+    case PromptEchoOn:
+    case PromptEchoOff:
         next = Idle;
         break;
     }
@@ -108,6 +128,11 @@ State nextState(const State state)
 	SET_NEW_STORAGE_BUFFER(loginName); \
     set_cursor(display, (event_mask)&0,programState);
 
+#define updateCompletion() \
+    if (((parameters.modes & e_Complete) == e_Complete) && (LoginName == programState)) { \
+        highlight_cursor(display,completion_count(rbuf,rlen) == 1); \
+    }
+
 
 static inline const char * stateToString(const State state)
 {
@@ -119,10 +144,27 @@ static inline const char * stateToString(const State state)
     return "";
 }
 
-#define TIMEOUTPERATTEMPT 30000
-#define MAXGOODWILL  (TIMEOUTPERATTEMPT*5)
-#define INITIALGOODWILL MAXGOODWILL
-#define GOODWILLPORTION 0.3
+static inline DiagPhase stateToPhase(const State state)
+{
+    DiagPhase phase = PhaseIdle;
+    switch(state) {
+    case Idle:
+        phase = PhaseIdle;
+        break;
+    case LoginName:
+        phase = PhaseEnteringLogin;
+        break;
+    case Password:
+        phase = PhaseEnteringPassword;
+        break;
+    case Authenticating:
+    case PromptEchoOn:
+    case PromptEchoOff:
+        phase = PhaseAuthenticating;
+        break;
+    }
+    return phase;
+}
 
 static char *get_username(char *buffer, const size_t size)
 {
@@ -225,7 +267,13 @@ static inline void log_session_lock()
 
 static void onExit(void)
 {
+    standby_release();
+    monitor_set_grabs(0);
+    monitor_close();
+    bus_close();
+    config_free();
     if (display) {
+        overlay_destroy();
         XUngrabKeyboard(display,CurrentTime);
         syslog(LOG_DEBUG,"exit XUngrabKeyboard");
         XFlush(display);
@@ -243,6 +291,34 @@ static inline void clear_buffer(char *buffer, size_t size)
     }
 }
 
+static void on_auth_session(int fd, short revents, void *data)
+{
+    /* handled by the main loop which owns the input state */
+    loop_interrupt();
+}
+
+/* reload thread: an empty allowed list enumerates the accounts through NSS */
+static void *prepare_config(const LockConfig *previous, const LockConfig *parsed)
+{
+    if (((parameters.modes & e_Complete) == e_Complete)
+            && ((parsed->nbAllowedUsers > 0) || (previous && (previous->nbAllowedUsers > 0)))) {
+        return completion_index_build(parsed->allowedUsers,parsed->nbAllowedUsers);
+    }
+    return NULL;
+}
+
+static void on_config_changed(const LockConfig *previous, const LockConfig *current, void *prepared)
+{
+    if (NULL == current) {
+        completion_index_free(prepared);
+        return;
+    }
+    credcache_set_path(current->credentialCache);
+    if (prepared) {
+        completion_install(prepared);
+    }
+}
+
 #if MULTITOUCH
 XIEventMask evmask;
 
@@ -254,6 +330,7 @@ void handle_multitouch(Cursor cursor)
     int xi_ndevices;
 
     info = XIQueryDevice(display, XIAllDevices, &xi_ndevices);
+    diag_round_trip();
 
     int i;
     for (i = 0; i < xi_ndevices; i++) {
@@ -278,27 +355,46 @@ void handle_multitouch(Cursor cursor)
 		syslog(LOG_DEBUG,"New cursor " #b ); \
 		break;
 
+/* grey25 on steelblue3 like the lock cursor, green3 background when the login name is complete */
+static const XColor cursorFg = { .red = 0x4040, .green = 0x4040, .blue = 0x4040 };
+static const XColor cursorBg = { .red = 0x4f4f, .green = 0x9494, .blue = 0xcdcd };
+static const XColor cursorHighlight = { .red = 0x0000, .green = 0xcdcd, .blue = 0x0000 };
+static Cursor stateCursor = None;
+
 void set_cursor(Display *display, unsigned int event_mask,State programState)
 {
-    XColor csr_fg, csr_bg;
+    XColor csr_fg = cursorFg, csr_bg = cursorBg;
     static Cursor cursor;
     Pixmap csr_source;
     Pixmap csr_mask;
 
     syslog(LOG_NOTICE,"State = %s",stateToString(programState));
+    monitor_set_state(programState,stateToString(programState));
+    diag_phase(stateToPhase(programState));
 
     switch(programState) {
         STATE_TABLE
     }
+    stateCursor = cursor;
 
     int error = XChangeActivePointerGrab(display,event_mask,cursor,CurrentTime);
     if (error != Success) {
         syslog(LOG_ERR,"XChangeActivePointerGrab error %d",error);
     }
     XSync(display,False);
+    diag_round_trip();
 }
 #undef X
 
+static void highlight_cursor(Display *display, Bool highlighted)
+{
+    XColor csr_fg = cursorFg;
+    XColor csr_bg = (highlighted)?cursorHighlight:cursorBg;
+    if (stateCursor != None) {
+        XRecolorCursor(display,stateCursor,&csr_fg,&csr_bg);
+    }
+}
+
 static inline void printVersion(void)
 {
     printf("xtrlock %s" EOL,program_version);
@@ -332,6 +428,31 @@ static inline void printHelp(const char *errorMsg)
 #undef USAGE
 }
 
+/* "privacy,events": the modes, named as in the configuration file */
+static int parse_modes(const char *list, unsigned int *modes)
+{
+    int error = EXIT_SUCCESS;
+    char *copy = strdup(list);
+    char *saveptr = NULL;
+    *modes = 0x0;
+    if (NULL == copy) {
+        return ENOMEM;
+    }
+    for (char *name = strtok_r(copy,", ",&saveptr); (name) && (EXIT_SUCCESS == error);
+            name = strtok_r(NULL,", ",&saveptr)) {
+#define X(m,k) else if (strcmp(name,k) == 0) { *modes |= e_##m; }
+        if (0) {
+        }
+        MODE_TABLE
+        else {
+            error = EINVAL;
+        }
+#undef X
+    }
+    free(copy);
+    return error;
+}
+
 static int parse_cmdLine(int argc,char *const argv[])
 {
 #define NEED_ARG        ":"
@@ -343,6 +464,9 @@ static int parse_cmdLine(int argc,char *const argv[])
     int optc;
 
     parameters.modes = 0x0;
+    parameters.modesSet = 0x0;
+    parameters.wakeupBudget = WAKEUP_BUDGET_NOT_SET;
+    parameters.configFile = NULL;
     while (((optc = getopt_long(argc, argv, CMDLINE_OPTS_TABLE, longopts, NULL)) != -1)
             && (EXIT_SUCCESS == error)) {
         switch (optc) {
@@ -355,6 +479,53 @@ static int parse_cmdLine(int argc,char *const argv[])
         case 'u':
             parameters.modes |= e_MultiUsers;
             break;
+        case 'm':
+            parameters.modes |= e_Monitor;
+            break;
+        case 'c':
+            parameters.modes |= e_Complete;
+            break;
+        case 'd':
+            parameters.modes |= e_Diagnostics;
+            break;
+        case 'C':
+            parameters.configFile = optarg;
+            break;
+        case 's':
+            parameters.modes |= e_Standby;
+            break;
+        case 'p':
+            parameters.modes |= e_Privacy;
+            break;
+        case 'o':
+            parameters.modes |= e_Overlay;
+            break;
+        case 'e':
+            parameters.modes |= e_Events;
+            break;
+        case 'n': {
+            unsigned int off = 0x0;
+            if (parse_modes(optarg,&off) == EXIT_SUCCESS) {
+                parameters.modes &= ~off;
+                parameters.modesSet |= off;
+            } else {
+                error = EINVAL;
+                printHelp("invalid mode list");
+            }
+            }
+            break;
+        case 'w': {
+            char *end = NULL;
+            const unsigned long budget = strtoul(optarg,&end,10);
+            if ((end != optarg) && ('\0' == *end) && (budget < UINT_MAX)) {
+                parameters.wakeupBudget = budget;
+                parameters.modes |= e_Diagnostics;
+            } else {
+                error = EINVAL;
+                printHelp("invalid wakeup budget");
+            }
+            }
+            break;
         case 'h':
             printHelp(NULL);
             exit(EXIT_SUCCESS);
@@ -373,6 +544,8 @@ static int parse_cmdLine(int argc,char *const argv[])
             break;
         } /* switch */
     } /*while(((optc = getopt_long(argc,argv,"cln:phv",longopts,NULL))!= -1) && (EXIT_SUCCESS == error))*/
+    /* the options which turn a mode on, -w included */
+    parameters.modesSet |= parameters.modes;
 #undef X
 #undef NEED_ARG
 #undef NO_ARG
@@ -387,15 +560,19 @@ int main(int argc, char **argv)
     KeySym ks;
     char cbuf[256];
     int clen, rlen=0;
-    long goodwill= INITIALGOODWILL, timeout= 0;
+    long goodwill, timeout= 0;
     XSetWindowAttributes attrib;
     Cursor cursor;
     Pixmap csr_source,csr_mask;
     XColor csr_fg, csr_bg, dummy, black;
     int ret, screen;
-    UserAuthenticationData user = {NULL,NULL};
+    UserAuthenticationData user = {NULL,NULL,NULL};
+    AuthSession *authSession = NULL;
+    Time authTime = 0;
+    Bool unlocked = False;
     char loginName[LOGIN_NAME_MAX];
     char password[256];
+    char answer[AUTH_MAX_ANSWER];
     char *rbuf = loginName;
     size_t bufferSize = sizeof(loginName);
     char *display_name = getenv("DISPLAY");
@@ -404,7 +581,8 @@ int main(int argc, char **argv)
     struct spwd *sp;
 #endif
     struct timeval tv;
-    int tvt, gs;
+    struct timespec takeoverStart;
+    int tvt, gs, standbyFd;
     unsigned int event_mask = KeyPressMask|KeyReleaseMask;
 
     error = parse_cmdLine(argc,argv);
@@ -414,6 +592,35 @@ int main(int argc, char **argv)
 
     openlog("xtrlock",LOG_CONS|LOG_PID,LOG_AUTH);
 
+    if (config_load(parameters.configFile) != EXIT_SUCCESS) {
+        fprintf(stderr,"xtrlock (version %s): invalid configuration file %s\n",
+                program_version,(parameters.configFile)?parameters.configFile:DEFAULT_CONFIG_FILE);
+        exit(1);
+    }
+    /* the command line takes precedence, the file sets the other modes */
+    parameters.modes = (parameters.modes & parameters.modesSet)
+                       | (config_get()->modes & ~parameters.modesSet);
+    if (WAKEUP_BUDGET_NOT_SET == parameters.wakeupBudget) {
+        parameters.wakeupBudget = config_get()->wakeupBudget;
+        if ((parameters.wakeupBudget != WAKEUP_BUDGET_NOT_SET)
+                && ((parameters.modesSet & e_Diagnostics) == 0)) {
+            parameters.modes |= e_Diagnostics;
+        }
+    }
+    if (((parameters.modes & e_Overlay) == e_Overlay)
+            && ((parameters.modes & (e_Blank|e_Privacy)) == 0)) {
+        /* the panel needs a window to be drawn on */
+        parameters.modes |= e_Blank;
+    }
+    goodwill = config_get()->maxGoodwill;
+    credcache_set_path(config_get()->credentialCache);
+
+    standbyFd = standby_role();
+    if (standbyFd != -1) {
+        /* already detached by the primary */
+        parameters.modes &= ~e_ForkAfter;
+    }
+
     display= XOpenDisplay(0);
     if (display==NULL) {
         fprintf(stderr,"xtrlock (version %s): cannot open display\n",
@@ -423,17 +630,25 @@ int main(int argc, char **argv)
 
     atexit(onExit);
 
+    if ((parameters.modes & e_Diagnostics) == e_Diagnostics) {
+        diag_start(display,parameters.wakeupBudget);
+    }
+
 #ifdef MULTITOUCH
     unsigned char mask[XIMaskLen(XI_LASTEVENT)];
     int xi_major = 2, xi_minor = 2, xi_opcode, xi_error, xi_event;
 
-    if (!XQueryExtension(display, INAME, &xi_opcode, &xi_event, &xi_error)) {
+    const Bool hasXi = XQueryExtension(display, INAME, &xi_opcode, &xi_event, &xi_error);
+    diag_round_trip();
+    if (!hasXi) {
         fprintf(stderr, "xtrlock (version %s): No X Input extension\n",
                 program_version);
         exit(1);
     }
 
-    if (XIQueryVersion(display, &xi_major, &xi_minor) != Success ||
+    const Status xiVersion = XIQueryVersion(display, &xi_major, &xi_minor);
+    diag_round_trip();
+    if (xiVersion != Success ||
             xi_major * 10 + xi_minor < 22) {
         fprintf(stderr,"xtrlock (version %s): Need XI 2.2\n",
                 program_version);
@@ -450,14 +665,31 @@ int main(int argc, char **argv)
 
     attrib.override_redirect= True;
 
-    if ((parameters.modes & e_Blank) == e_Blank) {
+    if ((parameters.modes & (e_Blank|e_Privacy)) != 0) {
+        unsigned long valuemask = CWOverrideRedirect|CWBackPixel;
         screen = DefaultScreen(display);
         attrib.background_pixel = BlackPixel(display, screen);
+        if ((parameters.modes & e_Privacy) == e_Privacy) {
+            /* captured before the lock window hides the screen */
+            attrib.background_pixmap = privacy_background(display, screen);
+            if (attrib.background_pixmap != None) {
+                valuemask = CWOverrideRedirect|CWBackPixmap;
+            }
+        }
         window= XCreateWindow(display,DefaultRootWindow(display),
                               0,0,DisplayWidth(display, screen),DisplayHeight(display, screen),
                               0,DefaultDepth(display, screen), CopyFromParent, DefaultVisual(display, screen),
-                              CWOverrideRedirect|CWBackPixel,&attrib);
+                              valuemask,&attrib);
         XAllocNamedColor(display, DefaultColormap(display, screen), "black", &black, &dummy);
+        diag_round_trip();
+        if ((parameters.modes & e_Overlay) == e_Overlay) {
+            char owner[LOGIN_NAME_MAX];
+            if (overlay_create(display,window,screen,get_username(owner,sizeof(owner))) == EXIT_SUCCESS) {
+                event_mask |= ExposureMask;
+            } else {
+                parameters.modes &= ~e_Overlay;
+            }
+        }
     } else {
         window= XCreateWindow(display,DefaultRootWindow(display),
                               0,0,1,1,0,CopyFromParent,InputOnly,CopyFromParent,
@@ -473,27 +705,53 @@ int main(int argc, char **argv)
                            DefaultColormap(display, DefaultScreen(display)),
                            "steelblue3",
                            &dummy, &csr_bg);
-    if (ret==0)
+    diag_round_trip();
+    if (ret==0) {
         XAllocNamedColor(display,
                          DefaultColormap(display, DefaultScreen(display)),
                          "black",
                          &dummy, &csr_bg);
+        diag_round_trip();
+    }
 
     ret = XAllocNamedColor(display,
                            DefaultColormap(display,DefaultScreen(display)),
                            "grey25",
                            &dummy, &csr_fg);
-    if (ret==0)
+    diag_round_trip();
+    if (ret==0) {
         XAllocNamedColor(display,
                          DefaultColormap(display, DefaultScreen(display)),
                          "white",
                          &dummy, &csr_bg);
+        diag_round_trip();
+    }
 
 
 
     cursor= XCreatePixmapCursor(display,csr_source,csr_mask,&csr_fg,&csr_bg,
                                 lock_x_hot,lock_y_hot);
 
+    if (standbyFd != -1) {
+        /* everything is built server side, wait for the primary to end */
+        XSync(display,False);
+        diag_round_trip();
+        syslog(LOG_NOTICE,"standby ready, window = %lu",window);
+        StandbyBackoff backoff = { .goodwill = goodwill, .timeout = timeout };
+        if (standby_wait(standbyFd,&backoff) != EXIT_SUCCESS) {
+            /* the primary has unlocked the session */
+            _exit(EXIT_SUCCESS);
+        }
+        /* no goodwill regained by killing the primary */
+        goodwill = backoff.goodwill;
+        timeout = backoff.timeout;
+        clock_gettime(CLOCK_MONOTONIC,&takeoverStart);
+        syslog(LOG_CRIT,"primary locker has died, taking over");
+        if ((parameters.modes & e_Diagnostics) == e_Diagnostics) {
+            diag_start(display,parameters.wakeupBudget);
+        }
+    }
+
     XMapWindow(display,window);
     syslog(LOG_NOTICE,"Window = %lu",window);
 
@@ -504,36 +762,43 @@ int main(int argc, char **argv)
      *(i.e. after 1s in total), then give up, and emit an error
      */
 
+    /* a standby retries every ms while the server releases the grabs of the dead primary */
+    const int grabRetries = (standbyFd != -1)?1000:100;
+    const long grabRetryDelay = 1000000L / grabRetries;
+
     gs=0; /*gs==grab successful*/
-    for (tvt=0 ; tvt<100; tvt++) {
+    for (tvt=0 ; tvt<grabRetries; tvt++) {
         ret = XGrabKeyboard(display,window,False,GrabModeAsync,GrabModeAsync,
                             CurrentTime);
+        diag_round_trip();
         if (ret == GrabSuccess) {
             gs=1;
             break;
         }
+        /*grab failed; wait .01s (.001s for a standby)*/
+        tv.tv_sec=0;
+        tv.tv_usec=grabRetryDelay;
+        select(1,NULL,NULL,NULL,&tv);
+    }
+    if (gs==0) {
+        /* only the last failure is reported */
+        const char *reason = NULL;
         switch(ret) {
         case AlreadyGrabbed:
-            fprintf(stderr,"AlreadyGrabbed, retrying...\n");
+            reason = "AlreadyGrabbed";
             break;
         case GrabFrozen:
-            fprintf(stderr,"GrabFrozen, retrying...\n");
+            reason = "GrabFrozen";
             break;
         case GrabInvalidTime:
-            fprintf(stderr,"GrabInvalidTime, retrying...\n");
+            reason = "GrabInvalidTime";
             break;
         default:
-            fprintf(stderr,"XGrabKeyboard retcode = %d, retrying...\n",ret);
+            reason = "XGrabKeyboard error";
             break;
         }
-        /*grab failed; wait .01s*/
-        tv.tv_sec=0;
-        tv.tv_usec=10000;
-        select(1,NULL,NULL,NULL,&tv);
-    }
-    if (gs==0) {
-        fprintf(stderr,"xtrlock (version %s): cannot grab keyboard\n",
-                program_version);
+        fprintf(stderr,"xtrlock (version %s): cannot grab keyboard (%s, retcode = %d, %d attempts)\n",
+                program_version,reason,ret,grabRetries);
         exit(1);
     }
 
@@ -545,6 +810,14 @@ int main(int argc, char **argv)
                 program_version);
         exit(1);
     }
+    diag_round_trip();
+
+    if (standbyFd != -1) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC,&now);
+        syslog(LOG_CRIT,"lock taken over %.3f ms after the death of the primary locker",
+               (now.tv_sec - takeoverStart.tv_sec) * 1e3 + (now.tv_nsec - takeoverStart.tv_nsec) / 1e6);
+    }
 
     if ((parameters.modes & e_ForkAfter) == e_ForkAfter) {
         pid_t pid = fork();
@@ -553,21 +826,123 @@ int main(int argc, char **argv)
                     program_version, strerror(errno));
             exit(1);
         } else if (pid > 0) {
-            exit(0);
+            /* no onExit: the X resources and the grabs belong to the child now */
+            _exit(0);
         }
     }
 
+    if ((parameters.modes & e_Standby) == e_Standby) {
+        if (standby_spawn(argv) == EXIT_SUCCESS) {
+            const StandbyBackoff backoff = { .goodwill = goodwill, .timeout = timeout };
+            standby_backoff(&backoff);
+        }
+    }
+
+    if (-1 == standbyFd) {
+        /* the grabs are held: the hooks cannot delay the lock */
+        const LockConfig *config = config_get();
+        hooks_run(HookPreLock,config->preLockHooks,config->hookTimeout,config->hookKill);
+    }
+
 #ifdef MULTITOUCH
     handle_multitouch(cursor);
 #endif
 
+    if ((parameters.modes & e_Monitor) == e_Monitor) {
+        if (monitor_open() == EXIT_SUCCESS) {
+            monitor_set_state(programState,stateToString(programState));
+            monitor_set_grabs(1);
+        }
+    }
+
+    if ((parameters.modes & e_Events) == e_Events) {
+        char owner[LOGIN_NAME_MAX];
+        if (bus_open(DisplayString(display),get_username(owner,sizeof(owner))) != EXIT_SUCCESS) {
+            parameters.modes &= ~e_Events;
+        }
+    }
+
+    if ((parameters.modes & e_Complete) == e_Complete) {
+        if ((parameters.modes & e_MultiUsers) == e_MultiUsers) {
+            completion_build(config_get()->allowedUsers,config_get()->nbAllowedUsers);
+        } else {
+            syslog(LOG_WARNING,"login name completion is only available in multi-user mode");
+            parameters.modes &= ~e_Complete;
+        }
+    }
+
+    config_watch(prepare_config,on_config_changed);
+
+    diag_phase(PhaseIdle);
     log_session_lock();
+    bus_publish(BusEvent_lock,NULL);
+    if ((parameters.modes & e_Overlay) == e_Overlay) {
+        overlay_start(time(NULL));
+    }
     for (;;) {
         XEvent ev;
 #ifdef FULL_DEBUG
         syslog(LOG_DEBUG,"waiting events.... ");
 #endif
-        XNextEvent(display,&ev);
+        if (loop_next_event(display,&ev) == EINTR) {
+            /* the authentication worker has a question or has finished */
+            if (authSession) {
+                AuthPromptStyle style;
+                const char *prompt = NULL;
+                const char *notice = NULL;
+                switch(auth_session_poll(authSession,&style,&prompt,&notice)) {
+                case AuthPrompt:
+                    syslog(LOG_DEBUG,"authentication question: %s",prompt);
+                    overlay_prompt(notice,prompt);
+                    SET_NEW_STORAGE_BUFFER(answer);
+                    programState = (AuthEchoOff == style)?PromptEchoOff:PromptEchoOn;
+                    set_cursor(display, (event_mask)&0,programState);
+                    break;
+                case AuthDone: {
+                    overlay_prompt(notice,NULL);
+                    loop_remove(auth_session_fd(authSession));
+                    const int authError = auth_session_end(authSession);
+                    authSession = NULL;
+                    monitor_set_auth(0);
+                    clear_buffer(password,sizeof(password));
+                    log_session_access(user.login, EXIT_SUCCESS == authError);
+                    if (EXIT_SUCCESS == authError) {
+                        /* before the grabs are released and the hooks waited for:
+                         * a death past this point is not a crash to take over */
+                        standby_release();
+                        bus_publish(BusEvent_unlock,user.login);
+                        unlocked = True;
+                        goto loop_x;
+                    }
+                    XBell(display,0);
+                    overlay_failed_attempt();
+                    bus_publish(BusEvent_failure,user.login);
+                    const LockConfig *config = config_get();
+                    if (timeout) {
+                        goodwill+= authTime - timeout;
+                        if (goodwill > config->maxGoodwill) {
+                            goodwill= config->maxGoodwill;
+                        }
+                    }
+                    timeout= -goodwill*config->goodwillPortion;
+                    goodwill+= timeout;
+                    timeout+= authTime + config->timeoutPerAttempt;
+                    const StandbyBackoff backoff = { .goodwill = goodwill, .timeout = timeout };
+                    standby_backoff(&backoff);
+                    resetState();
+                    }
+                    break;
+                case AuthPending:
+                    break;
+                }
+            }
+            continue;
+        }
+        if ((Idle == programState) || (Authenticating == programState)) {
+            /* the typing of a secret is not published */
+            monitor_event();
+        }
+        diag_event(ev.type);
 #ifdef FULL_DEBUG
         syslog(LOG_DEBUG,"ev.type = %d",ev.type);
 #endif
@@ -577,11 +952,25 @@ int main(int argc, char **argv)
                 XBell(display,0);
                 break;
             }
+            if (Authenticating == programState) {
+                /* the keys typed while the backend works are dropped */
+                break;
+            }
             clen= XLookupString(&ev.xkey,cbuf,9,&ks,0);
             switch (ks) {
             case XK_Escape:
             case XK_Clear:
-                resetState();
+                if ((PromptEchoOn == programState) || (PromptEchoOff == programState)) {
+                    /* cancel the question, the backend will fail the transaction */
+                    clear_buffer(answer,sizeof(answer));
+                    rlen = 0;
+                    auth_session_answer(authSession,NULL);
+                    overlay_prompt(NULL,NULL);
+                    programState = Authenticating;
+                    set_cursor(display, (event_mask)&0,programState);
+                } else {
+                    resetState();
+                }
                 syslog(LOG_DEBUG,"clear");
                 break;
             case XK_Delete:
@@ -593,6 +982,7 @@ int main(int argc, char **argv)
                     }
                     syslog(LOG_DEBUG,"cleared");
                 }
+                updateCompletion();
                 break;
             case XK_Linefeed:
             case XK_Return:
@@ -607,32 +997,61 @@ int main(int argc, char **argv)
                         programState = nextState(programState);
                         set_cursor(display, (event_mask)&0,programState);
                     } else if (Password == programState) {
-                        int error = EXIT_SUCCESS;
                         user.password = rbuf;
 #ifdef DUMP_CREDENTIALS
                         syslog(LOG_DEBUG,"password = %s",user.password);
 #endif
                         rlen = 0;
-                        error = authenticate(&user);
-                        clear_buffer(password,sizeof(password));
-                        log_session_access(user.login, EXIT_SUCCESS == error);
-                        if (EXIT_SUCCESS == error) {
-                            goto loop_x;
-                        }
-                        XBell(display,0);
-                        if (timeout) {
-                            goodwill+= ev.xkey.time - timeout;
-                            if (goodwill > MAXGOODWILL) {
-                                goodwill= MAXGOODWILL;
+                        authTime = ev.xkey.time;
+                        const LockConfig *config = config_get();
+                        AuthBackend backend = auth_deny;
+                        AuthBackend fallback = NULL;
+                        int fallbackOn = AUTH_ANY_ERROR;
+                        /* in mono-user mode the session owner is always allowed */
+                        if (((parameters.modes & e_MultiUsers) != e_MultiUsers)
+                                || (config_user_allowed(config,user.login))) {
+                            backend = config->backend;
+                            if (CredCacheFirst == config->cacheMode) {
+                                fallback = backend;
+                                backend = (auth_pam == backend)?auth_credcache_pam:auth_credcache;
+                            } else if (CredCacheFallback == config->cacheMode) {
+                                fallback = auth_credcache;
+                                fallbackOn = EAGAIN;
                             }
                         }
-                        timeout= -goodwill*GOODWILLPORTION;
-                        goodwill+= timeout;
-                        timeout+= ev.xkey.time + TIMEOUTPERATTEMPT;
-                        resetState();
+                        /* the questions of the backend can only be read on the overlay */
+                        const int interactive = ((parameters.modes & e_Overlay) == e_Overlay);
+                        if (auth_session_start(&user,backend,fallback,fallbackOn,interactive,&authSession) == EXIT_SUCCESS) {
+                            monitor_set_auth(1);
+                            loop_add(auth_session_fd(authSession),POLLIN,on_auth_session,NULL,"auth");
+                            programState = nextState(programState);
+                            set_cursor(display, (event_mask)&0,programState);
+                        } else {
+                            clear_buffer(password,sizeof(password));
+                            XBell(display,0);
+                            resetState();
+                        }
+                    } else if ((PromptEchoOn == programState) || (PromptEchoOff == programState)) {
+                        auth_session_answer(authSession,rbuf);
+                        overlay_prompt(NULL,NULL);
+                        clear_buffer(answer,sizeof(answer));
+                        rlen = 0;
+                        programState = Authenticating;
+                        set_cursor(display, (event_mask)&0,programState);
                     }
                 }
                 break;
+            case XK_Tab:
+                if (((parameters.modes & e_Complete) == e_Complete) && (LoginName == programState)) {
+                    size_t length = rlen;
+                    if (completion_complete(rbuf,&length,bufferSize) == 0) {
+                        XBell(display,0);
+                    }
+                    rlen = length;
+                    updateCompletion();
+                    break;
+                }
+                /* no break: Tab is a regular character */
             default:
                 if (clen != 1) break;
                 if (Idle == programState) {
@@ -655,10 +1074,16 @@ int main(int argc, char **argv)
                 } else {
                 	syslog(LOG_ERR,"Storage buffer is too small to store the %s (limit = %zu)",stateToString(programState),bufferSize);
                 }
+                updateCompletion();
 
                 break;
             }
             break;
+        case Expose:
+            if (0 == ev.xexpose.count) {
+                overlay_expose();
+            }
+            break;
 #if MULTITOUCH
         case GenericEvent:
             if (ev.xcookie.extension == xi_opcode &&
@@ -673,6 +1098,19 @@ int main(int argc, char **argv)
         }
     }
 loop_x:
+    if ((unlocked) && ((config_get()->postUnlockHooks) || (hooks_pending()))) {
+        /* give the screen back before running or waiting for the hooks */
+        XUngrabPointer(display,CurrentTime);
+        XUngrabKeyboard(display,CurrentTime);
+        XUnmapWindow(display,window);
+        XFlush(display);
+        monitor_set_grabs(0);
+        const LockConfig *config = config_get();
+        hooks_run(HookPostUnlock,config->postUnlockHooks,config->hookTimeout,config->hookKill);
+    }
+    /* the pre-lock hooks still running are not orphaned: waited for or killed at their deadline */
+    hooks_wait();
+    diag_report();
     closelog();
     return error;
 }